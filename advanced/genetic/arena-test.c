@@ -0,0 +1,35 @@
+#include "arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define BLOCK_SZ        256
+#define NUM_ALLOCS      16
+#define BIG_SZ          (4 * BLOCK_SZ)
+
+int main(void) {
+        arena_t *arena = arena_new(BLOCK_SZ);
+        printf("small allocs:\n");
+        for (size_t i=0; i<NUM_ALLOCS; i++) {
+                size_t *p = arena_alloc(arena, sizeof(*p) * (i + 1));
+                p[i] = i;
+                printf("alloc %zu aligned: %d\n", i,
+                       ((uintptr_t)p % _Alignof(max_align_t)) == 0);
+        }
+        printf("mark/rewind:\n");
+        arena_mark_t mark = arena_mark(arena);
+        void *first = arena_alloc(arena, BIG_SZ);
+        arena_rewind(arena, mark);
+        void *again = arena_alloc(arena, BIG_SZ);
+        printf("same memory after rewind: %d\n", first == again);
+        unsigned char *zeroed = arena_calloc(arena, BIG_SZ, 1);
+        size_t nonzero = 0;
+        for (size_t i=0; i<BIG_SZ; i++) {
+                nonzero += (zeroed[i] != 0);
+        }
+        printf("calloc nonzero bytes: %zu\n", nonzero);
+        printf("free\n");
+        arena_free(arena);
+        return 0;
+}
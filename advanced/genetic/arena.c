@@ -0,0 +1,84 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdalign.h>
+#include <assert.h>
+
+#define ARENA_ALIGN     alignof(max_align_t)
+#define ALIGN_UP(N)     (((N) + (ARENA_ALIGN - 1)) & ~(ARENA_ALIGN - 1))
+
+struct arena_block {
+        struct arena_block *next;
+        size_t size;
+        size_t used;
+        alignas(max_align_t) unsigned char data[];
+};
+struct arena {
+        size_t block_size;
+        struct arena_block *head;
+        struct arena_block *cur;
+};
+
+static struct arena_block *block_alloc(size_t size) {
+        struct arena_block *block = malloc(offsetof(struct arena_block, data)
+                                           + size);
+        *block = (struct arena_block){.next = NULL,
+                                      .size = size,
+                                      .used = 0};
+        return block;
+}
+
+arena_t *arena_new(size_t block_size) {
+        assert(block_size > 0);
+        arena_t *arena = malloc(sizeof(*arena));
+        *arena = (arena_t){.block_size = ALIGN_UP(block_size)};
+        arena->head = arena->cur = block_alloc(arena->block_size);
+        return arena;
+}
+void arena_free(arena_t *arena) {
+        if (arena == NULL) {
+                return;
+        }
+        for (struct arena_block *block = arena->head, *next;
+             block != NULL;
+             block = next) {
+                next = block->next;
+                free(block);
+        }
+        free(arena);
+}
+
+void *arena_alloc(arena_t *arena, size_t size) {
+        size = ALIGN_UP(size);
+        struct arena_block *cur = arena->cur;
+        if (cur->size - cur->used < size) {
+                /* move on to the next kept block if it is big enough,
+                 * otherwise splice a new one in after the current block */
+                struct arena_block *next = cur->next;
+                if ((next == NULL) || (next->size < size)) {
+                        next = block_alloc((size > arena->block_size)
+                                           ? size : arena->block_size);
+                        next->next = cur->next;
+                        cur->next = next;
+                }
+                next->used = 0;
+                arena->cur = cur = next;
+        }
+        void *ptr = cur->data + cur->used;
+        cur->used += size;
+        return ptr;
+}
+void *arena_calloc(arena_t *arena, size_t count, size_t size) {
+        void *ptr = arena_alloc(arena, count * size);
+        memset(ptr, 0, count * size);
+        return ptr;
+}
+
+arena_mark_t arena_mark(const arena_t *arena) {
+        return (arena_mark_t){.block = arena->cur,
+                              .used = arena->cur->used};
+}
+void arena_rewind(arena_t *arena, arena_mark_t mark) {
+        arena->cur = mark.block;
+        arena->cur->used = mark.used;
+}
@@ -0,0 +1,29 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/* Bump allocator. Everything allocated from an arena since a mark is
+ * released at once by arena_rewind() to it, and everything by
+ * arena_free(); the blocks themselves are kept across rewinds, so a
+ * reused arena stops calling malloc once it has grown to its working
+ * size. An arena is not thread-safe: each thread owns its own. */
+typedef struct arena arena_t;
+
+/* position in an arena to rewind to, for scratch allocations */
+typedef struct arena_mark arena_mark_t;
+struct arena_mark {
+        struct arena_block *block;
+        size_t used;
+};
+
+arena_t *arena_new(size_t block_size);
+void arena_free(arena_t *arena);
+
+void *arena_alloc(arena_t *arena, size_t size);
+void *arena_calloc(arena_t *arena, size_t count, size_t size);
+
+arena_mark_t arena_mark(const arena_t *arena);
+void arena_rewind(arena_t *arena, arena_mark_t mark);
+
+#endif /* !ARENA_H */
@@ -10,6 +10,8 @@
 #define MUT_RT          0.05
 #define TOURN_P         1.0
 #define TOURN_SZ        2
+#define FITNESS_K       2
+#define SEED            1
 
 int main(void) {
         long double *arr = malloc(ARR_SZ * sizeof(*arr));
@@ -25,8 +27,66 @@ int main(void) {
                          .max_mutation_rate = MUT_RT,
                          .tournament_p = TOURN_P,
                          .tournament_size = TOURN_SZ,
+                         .fitness_k = FITNESS_K,
+                         .repair = REPAIR_FF,
+                         .seed = SEED,
                          .use_inversion_operator = true};
         result_free(bin_packing(&ps));
+
+        /* without a cancel this would run for a minute */
+        ps.max_generations = (size_t)-1;
+        ps.max_secs = 60;
+        ps.results_only = true;
+        bp_run_t *run = bin_packing_start(&ps);
+        result_t *best = bin_packing_best(run);
+        bin_packing_cancel(run);
+        result_t *res = bin_packing_wait(run);
+        printf("final at least as fit as an earlier best: %d\n",
+               res->fitness >= best->fitness);
+        result_free(best);
+        result_free(res);
+
+        /* a run stops on a shared incumbent that reaches its target, and
+         * reports it rather than its own elite */
+        ps.max_generations = MAX_GEN;
+        ps.board = board_new(arr, ARR_SZ, CAP);
+        result_free(bin_packing(&ps));
+        size_t shared_bins = board_best(ps.board)->num_bins;
+        ps.terminal_num_bins = shared_bins;
+        ps.seed = SEED + 1;
+        res = bin_packing(&ps);
+        printf("incumbent at the target taken: %d\n",
+               res->num_bins == shared_bins);
+        result_free(res);
+        board_free(ps.board);
+        ps.board = NULL;
+        ps.terminal_num_bins = 0;
+
+        const char *rules[] = {[PACK_FF] = "ff", [PACK_FFD] = "ffd",
+                               [PACK_BF] = "bf", [PACK_BFD] = "bfd",
+                               [PACK_WF] = "wf"};
+        for (pack_rule_t r=0; r<sizeof(rules)/sizeof(*rules); r++) {
+                res = bin_packing_heuristic(&ps, r);
+                size_t count = 0;
+                bool fits = true;
+                for (size_t b=0; b<res->num_bins; b++) {
+                        long double fill = 0;
+                        for (size_t i=0; i<res->bins[b]->num_elems; i++) {
+                                fill += res->bins[b]->elems[i];
+                        }
+                        fits = fits && (fill <= CAP);
+                        count += res->bins[b]->num_elems;
+                }
+                printf("%s packs every item: %d, within capacity: %d\n",
+                       rules[r], count == ARR_SZ, fits);
+                result_free(res);
+        }
+        /* thirds cannot be scaled to integers */
+        for (size_t i=0; i<ARR_SZ; i++) {
+                arr[i] = CAP / 3.0L;
+        }
+        printf("unscalable sizes refused: %d\n",
+               bin_packing_heuristic(&ps, PACK_FF) == NULL);
         free(arr);
         return 0;
 }
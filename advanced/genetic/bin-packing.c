@@ -1,46 +1,57 @@
 #include "bin-packing.h"
 #include "population.h"
+#include "mailbox.h"
+#include "queue.h"
 #include <stdlib.h>
 #include <assert.h>
 #include <stdio.h>
 #include <math.h>
 #include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sched.h>
 
-#define CLOCK2SEC(START, END) \
-        (((double)END - START) * ((double)1.0 / CLOCKS_PER_SEC))
+#define ARENA_BLOCK_SZ  (1 << 20)
+/* odd constants mixed into the seed of every worker and island past the
+ * first */
+#define WORKER_SEED_MIX UINT64_C(0xD1B54A32D192ED03)
+#define ISLAND_SEED_MIX UINT64_C(0xA0761D6478BD642F)
 
 #if defined (DEBUG_BIN)
-static void print_bin(const bin_t *bin) {
+static void print_bin(const sizes_t *sizes, const chrom_t *chrom,
+                      const bin_t *bin) {
         printf("fill: %Lf\n"
                "count: %zu\n"
                "item_indices:\n",
-               bin->fill, bin->count);
+               sizes_fill(sizes, &bin->fill), bin->count);
         for (size_t i=0; i<bin->count; i++) {
-                printf("%zu ", bin->item_indices[i]);
+                printf("%zu ", chrom_item(chrom, bin->start + i));
         }
         putchar('\n');
 }
-static void print_chrom(const chrom_t *chrom) {
+static void print_chrom(const sizes_t *sizes, const chrom_t *chrom) {
         printf("fitness: %lf\n"
                "bin_cap: %Lf\n"
                "num_bins: %zu\n"
                "bins:\n",
-               chrom->fitness, chrom->bin_cap, chrom->num_bins);
+               chrom->fitness, sizes->bin_cap, chrom->num_bins);
         for (size_t i=0; i<chrom->num_bins; i++) {
                 printf("bin %zu:\n", i);
-                print_bin(chrom->bins[i]);
+                print_bin(sizes, chrom, &chrom->bins[i]);
         }
 }
 #endif
 
-static struct llarray *result_bin_alloc(const bin_t *bin,
+static struct llarray *result_bin_alloc(const chrom_t *chrom,
+                                        const bin_t *bin,
                                         const long double *item_sizes,
                                         size_t num_items) {
         struct llarray *arr = malloc(offsetof(struct llarray, elems)
                                      + (bin->count * sizeof(*arr->elems)));
         arr->num_elems = bin->count;
         for (size_t i=0; i<arr->num_elems; i++) {
-                arr->elems[i] = item_sizes[bin->item_indices[i]];
+                size_t item = chrom_item(chrom, bin->start + i);
+                arr->elems[i] = item_sizes[item];
         }
         return arr;
 }
@@ -52,7 +63,8 @@ static result_t *result_alloc(const chrom_t *best_chrom,
         *res = (result_t){.fitness = best_chrom->fitness,
                           .num_bins = best_chrom->num_bins};
         for (size_t i=0; i<res->num_bins; i++) {
-                res->bins[i] = result_bin_alloc(best_chrom->bins[i],
+                res->bins[i] = result_bin_alloc(best_chrom,
+                                                &best_chrom->bins[i],
                                                 item_sizes, num_items);
         }
         return res;
@@ -65,85 +77,671 @@ void result_free(result_t *res) {
 }
 
 typedef pop_t tourn_t;
-static tourn_t *tournament_select(const pop_t *pop, size_t mating_pool_size,
-                                  double tournament_p,
-                                  unsigned tournament_size) {
-        /* initialize container for tournament */
-        tourn_t *mp = pop_alloc(mating_pool_size);
-        /* fill mating pool through tournament selection */
-        for (size_t i=0; i<mating_pool_size; i++) {
-                mp->chroms[i] = pop->chroms[rand() % pop->num_chroms];
-                /* apply selection based on chosen tournament size */
-                for (unsigned j=1; j<tournament_size; j++) {
-                        size_t k = rand() % pop->num_chroms;
-                        if (mp->chroms[i]->fitness
-                            < pop->chroms[k]->fitness) {
-                                mp->chroms[i] = pop->chroms[k];
-                        }
+/** Returns the index of the fittest of tournament_size random members of
+ * pop */
+static size_t tournament_pick(rng_t *rng, const pop_t *pop,
+                              unsigned tournament_size) {
+        size_t pick = rng_below(rng, pop->num_chroms);
+        for (unsigned j=1; j<tournament_size; j++) {
+                size_t k = rng_below(rng, pop->num_chroms);
+                if (pop->chroms[pick]->fitness < pop->chroms[k]->fitness) {
+                        pick = k;
                 }
         }
-        return mp;
+        return pick;
 }
-static inline void tourn_free(tourn_t *mating_pool) {
-        free(mating_pool);
+static void tournament_select(rng_t *rng, tourn_t *mp, const pop_t *pop,
+                              double tournament_p,
+                              unsigned tournament_size) {
+        /* fill mating pool through tournament selection */
+        for (size_t i=0; i<mp->num_chroms; i++) {
+                mp->chroms[i] = pop->chroms[tournament_pick(rng, pop,
+                                                            tournament_size)];
+        }
 }
-static const chrom_t *find_elite(const pop_t *pop) {
-        const chrom_t *elite = pop->chroms[0];
+/** Returns the index of the fittest chromosome in pop */
+static size_t find_elite(const pop_t *pop) {
+        size_t elite = 0;
         for (size_t i=1; i<pop->num_chroms; i++) {
-                if (pop->chroms[i]->fitness > elite->fitness) {
-                        elite = pop->chroms[i];
+                if (pop->chroms[i]->fitness > pop->chroms[elite]->fitness) {
+                        elite = i;
                 }
         }
         return elite;
 }
-static pop_t *child_pop(const tourn_t *mating_pool, size_t population_size,
-                        const chrom_t *elite_chrom,
-                        const long double *item_sizes, size_t num_items) {
-        pop_t *child = pop_alloc(population_size);
-        child->chroms[0] = chrom_copy(elite_chrom);
-        for (size_t i=1; i<child->num_chroms; i++) {
-                size_t i1 = rand() % mating_pool->num_chroms;
-                size_t i2 = rand() % mating_pool->num_chroms;
-                child->chroms[i] = chrom_cx(mating_pool->chroms[i1],
-                                            mating_pool->chroms[i2],
-                                            item_sizes, num_items);
-        }
-        return child;
-}
-static void mutate_pop(pop_t *pop, double mutation_rate,
-                       const long double *item_sizes, size_t num_items) {
-        /* starts at 1 because 0 contains the elite chromosome from
-         * previous generations */
+/** Moves the elite of pop into slot 0 of child rather than copying it,
+ * leaving child's spare chromosome in its slot */
+static void keep_elite(pop_t *child, pop_t *pop, size_t elite) {
+        /* the mating pool points at the chromosomes, not the slots, so it
+         * still reaches the elite; nothing reads pop's slots again until
+         * the buffers swap and it is overwritten */
+        chrom_t *elite_chrom = pop->chroms[elite];
+        pop->chroms[elite] = child->chroms[0];
+        child->chroms[0] = elite_chrom;
+}
+static inline void print_stats(FILE *out, size_t gen_num,
+                               const chrom_t *best_chrom, double secs) {
+        fprintf(out, "%zu\t %zu\t %lf\t %lf\n",
+               gen_num, best_chrom->num_bins, best_chrom->fitness, secs);
+}
+static double timespec_secs(const struct timespec *ts) {
+        return ts->tv_sec + (ts->tv_nsec * 1e-9);
+}
+/** Returns the seconds since some fixed point, on CLOCK_MONOTONIC, which
+ * counts wall time whatever the number of threads and is never set
+ * back */
+static double now_secs(void) {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return timespec_secs(&ts);
+}
+
+/* Children only read the parents, so each worker makes a fixed slice of
+ * them: crossover, inversion and mutation, with its own workspace, so
+ * its own generator and scratch arena. Worker 0 is the calling thread,
+ * which also runs the selection between generations; the others wait on
+ * the start barrier for a generation to make. */
+typedef struct gen_ctx gen_ctx_t;
+typedef struct worker worker_t;
+struct gen_ctx {
+        const prob_set_t *ps;
+        const sizes_t *sizes;
+        /* the generation being made */
+        pop_t *child;
+        const tourn_t *mating_pool;
+        /* set by worker 0 before the start barrier to end the run */
+        bool stop;
+        pthread_barrier_t start, done;
+        /* the queues of the steady-state pipeline, and its end */
+        queue_t *tasks, *born, *recycle;
+        atomic_bool halt;
+};
+struct worker {
+        pthread_t thread;
+        gen_ctx_t *ctx;
+        chrom_ws_t *ws;
+        /* the children made by this worker, [lo, hi) */
+        size_t lo, hi;
+        /* the fittest of them, found in the same pass */
+        size_t best;
+};
+
+/** Makes the slice of children of w and finds the fittest of them */
+static void make_slice(worker_t *w) {
+        const gen_ctx_t *ctx = w->ctx;
+        const prob_set_t *ps = ctx->ps;
+        const tourn_t *mp = ctx->mating_pool;
+        chrom_t **chroms = ctx->child->chroms;
+        w->best = w->lo;
+        for (size_t i=w->lo; i<w->hi; i++) {
+                size_t i1 = rng_below(&w->ws->rng, mp->num_chroms);
+                size_t i2 = rng_below(&w->ws->rng, mp->num_chroms);
+                chrom_cx(w->ws, chroms[i], mp->chroms[i1], mp->chroms[i2],
+                         ctx->sizes);
+                if (ps->use_inversion_operator) {
+                        chrom_sort_bins(chroms[i], ctx->sizes);
+                }
+                chrom_mutate(w->ws, chroms[i], ps->max_mutation_rate,
+                             ctx->sizes);
+                if (chroms[i]->fitness > chroms[w->best]->fitness) {
+                        w->best = i;
+                }
+        }
+}
+
+/* With ps->steady_state there is no generation barrier: the island's
+ * thread keeps a queue of breeding tasks topped up from the current
+ * population, the workers breed them as they come, and each child goes
+ * back on the born queue to replace the worst chromosome at once if it is
+ * fitter. Chromosomes are reference counted members, held by their slot
+ * in the population and by the tasks breeding from them, so one leaves
+ * the population without waiting for its readers; the last to let go
+ * puts it on the recycle queue. Only the island's thread, which also
+ * breeds when it has nothing else to do, touches the population. */
+typedef struct member member_t;
+struct member {
+        chrom_t *chrom;
+        atomic_uint refs;
+};
+typedef struct breed breed_t;
+struct breed {
+        member_t *parent1, *parent2;
+        member_t *child;
+};
+
+static void member_release(gen_ctx_t *ctx, member_t *m) {
+        if (atomic_fetch_sub_explicit(&m->refs, 1, memory_order_acq_rel)
+            == 1) {
+                /* cannot fail: it holds every member */
+                queue_push(ctx->recycle, m);
+        }
+}
+static void breed_child(worker_t *w, breed_t *b) {
+        const prob_set_t *ps = w->ctx->ps;
+        const sizes_t *sizes = w->ctx->sizes;
+        chrom_t *child = b->child->chrom;
+        chrom_cx(w->ws, child, b->parent1->chrom, b->parent2->chrom, sizes);
+        if (ps->use_inversion_operator) {
+                chrom_sort_bins(child, sizes);
+        }
+        chrom_mutate(w->ws, child, ps->max_mutation_rate, sizes);
+        member_release(w->ctx, b->parent1);
+        member_release(w->ctx, b->parent2);
+}
+static void steady_worker(worker_t *w) {
+        gen_ctx_t *ctx = w->ctx;
+        while (!atomic_load_explicit(&ctx->halt, memory_order_acquire)) {
+                void *task;
+                if (!queue_pop(ctx->tasks, &task)) {
+                        sched_yield();
+                        continue;
+                }
+                breed_child(w, task);
+                /* cannot fail: it holds every task */
+                queue_push(ctx->born, task);
+        }
+}
+
+static void *worker_main(void *arg) {
+        worker_t *w = arg;
+        gen_ctx_t *ctx = w->ctx;
+        if (ctx->ps->steady_state) {
+                steady_worker(w);
+                return NULL;
+        }
+        for (;;) {
+                pthread_barrier_wait(&ctx->start);
+                if (ctx->stop) {
+                        return NULL;
+                }
+                make_slice(w);
+                pthread_barrier_wait(&ctx->done);
+        }
+}
+/** Makes the children of ctx, slot 0 aside, on all workers; returns the
+ * index of the fittest child, reduced from the workers' own */
+static size_t make_children(worker_t *workers, size_t num_workers) {
+        gen_ctx_t *ctx = workers[0].ctx;
+        if (num_workers > 1) {
+                pthread_barrier_wait(&ctx->start);
+        }
+        make_slice(&workers[0]);
+        if (num_workers > 1) {
+                pthread_barrier_wait(&ctx->done);
+        }
+        /* ties go to the lowest index, as a serial search would */
+        chrom_t **chroms = ctx->child->chroms;
+        size_t best = 0;
+        for (size_t w=0; w<num_workers; w++) {
+                if ((workers[w].lo < workers[w].hi)
+                    && (chroms[workers[w].best]->fitness
+                        > chroms[best]->fitness)) {
+                        best = workers[w].best;
+                }
+        }
+        return best;
+}
+
+/* An island is one population, made by its own pool of workers. Every
+ * island runs on its own thread, and every migration_interval
+ * generations it takes the migrant in its mailbox, if there is one, in
+ * place of its worst chromosome, and posts its elite to its neighbour in
+ * the ring or to a random island. */
+typedef struct island island_t;
+struct island {
+        bp_run_t *run;
+        size_t index;
+        pthread_t thread;
+        mailbox_t inbox;
+        arena_t *arena;
+        gen_ctx_t ctx;
+        worker_t *workers;
+        size_t num_workers;
+        pop_t *pop;
+        /* index of the elite of pop */
+        size_t best;
+        /* fitness of the last elite published to the run */
+        double published;
+        /* bins of the last elite offered to the board */
+        size_t offered;
+        /* with ps->steady_state, the member in each slot of pop, the
+         * tasks and members on hand, and the tasks being bred */
+        member_t **slots;
+        breed_t **free_breeds;
+        size_t num_free_breeds;
+        member_t **free_members;
+        size_t num_free_members;
+        size_t in_flight;
+};
+/* A run owns its islands and a copy of the best chromosome any of them
+ * has had, which the islands update as they improve and which can be
+ * read at any moment. */
+struct bp_run {
+        const prob_set_t *ps;
+        /* on the clock of now_secs() */
+        double start, deadline;
+        atomic_bool cancelled;
+        /* set by the first island to meet the termination criteria, so
+         * that the others stop too */
+        atomic_bool solved;
+        arena_t *arena;
+        island_t *islands;
+        size_t num_islands;
+        /* runs run_main() for bin_packing_start() */
+        pthread_t thread;
+        /* guards best and have_best */
+        pthread_mutex_t lock;
+        pthread_cond_t published;
+        chrom_t *best;
+        bool have_best;
+};
+
+/** Returns true if a needs fewer bins than b, or as many and is fitter */
+static bool better(const chrom_t *a, const chrom_t *b) {
+        if (a->num_bins != b->num_bins) {
+                return a->num_bins < b->num_bins;
+        }
+        return a->fitness > b->fitness;
+}
+/** Copies the elite of isl to the run if it is the best yet */
+static void publish(island_t *isl) {
+        bp_run_t *run = isl->run;
+        const chrom_t *elite = isl->pop->chroms[isl->best];
+        isl->published = elite->fitness;
+        pthread_mutex_lock(&run->lock);
+        if (!run->have_best || better(elite, run->best)) {
+                chrom_copy(run->best, elite);
+                run->have_best = true;
+                pthread_cond_broadcast(&run->published);
+        }
+        pthread_mutex_unlock(&run->lock);
+}
+
+/** Returns the index of the least fit chromosome in pop */
+static size_t find_worst(const pop_t *pop) {
+        size_t worst = 0;
         for (size_t i=1; i<pop->num_chroms; i++) {
-                chrom_mutate(pop->chroms[i], mutation_rate,
-                             item_sizes, num_items);
+                if (pop->chroms[i]->fitness < pop->chroms[worst]->fitness) {
+                        worst = i;
+                }
         }
+        return worst;
 }
-static inline void print_stats(size_t gen_num, const chrom_t *best_chrom,
-                               double secs) {
-        printf("%zu\t %zu\t %lf\t %lf\n",
-               gen_num, best_chrom->num_bins, best_chrom->fitness, secs);
+/** Copies migrant over the worst chromosome of isl */
+static void take_migrant(island_t *isl, const chrom_t *migrant) {
+        pop_t *pop = isl->pop;
+        size_t worst = find_worst(pop);
+        /* the elite is only ever replaced by a fitter one */
+        if ((worst != isl->best)
+            || (migrant->fitness > pop->chroms[worst]->fitness)) {
+                chrom_copy(pop->chroms[worst], migrant);
+                if (migrant->fitness > pop->chroms[isl->best]->fitness) {
+                        isl->best = worst;
+                }
+        }
 }
-static int bin_cmp(const void *a, const void *b) {
-        const bin_t *av = *(bin_t **)a;
-        const bin_t *bv = *(bin_t **)b;
-        if (av->fill < bv->fill) {
-                return -1;
-        } else if (av->fill > bv->fill) {
-                return 1;
+static void migrate(island_t *isl) {
+        const bp_run_t *run = isl->run;
+        pop_t *pop = isl->pop;
+        const chrom_t *migrant = mailbox_take(&isl->inbox);
+        if (migrant != NULL) {
+                take_migrant(isl, migrant);
+        }
+        size_t dest;
+        if (run->ps->migration == MIGRATE_RING) {
+                dest = (isl->index + 1) % run->num_islands;
         } else {
+                rng_t *rng = &isl->workers[0].ws->rng;
+                dest = rng_below(rng, run->num_islands - 1);
+                dest += (dest >= isl->index);
+        }
+        mailbox_post(&run->islands[dest].inbox, pop->chroms[isl->best]);
+}
+
+/** Takes the incumbent of the board as a migrant if it needs fewer bins
+ * than the elite of isl */
+static void adopt(island_t *isl) {
+        const chrom_t *incumbent = board_best(isl->run->ps->board);
+        if ((incumbent != NULL)
+            && (incumbent->num_bins < isl->pop->chroms[isl->best]->num_bins)) {
+                take_migrant(isl, incumbent);
+        }
+}
+/** Returns true if board has an incumbent of at most target bins */
+static bool board_reached(const board_t *board, size_t target) {
+        if (board == NULL) {
+                return false;
+        }
+        const chrom_t *incumbent = board_best(board);
+        return (incumbent != NULL) && (incumbent->num_bins <= target);
+}
+/** Returns the bins at which a run stops once any run sharing its board
+ * has got that far, which is optimal if it is the lower bound */
+static size_t board_target(const prob_set_t *ps) {
+        if (ps->board == NULL) {
                 return 0;
         }
+        size_t target = board_lower_bound(ps->board);
+        return (target < ps->terminal_num_bins) ? ps->terminal_num_bins
+                                                : target;
 }
-static void inversion(pop_t *pop) {
-        /* start at 1 because 0 is the elite chromosome */
-        for (size_t i=1; i<pop->num_chroms; i++) {
-                qsort(pop->chroms[i]->bins, pop->chroms[i]->num_bins,
-                      sizeof(*pop->chroms[i]->bins), bin_cmp);
+/** Makes the incumbent of the board the elite of isl, and so the best of
+ * the run, if it needs fewer bins; the run stops with it */
+static void take_incumbent(island_t *isl) {
+        const chrom_t *incumbent = board_best(isl->run->ps->board);
+        chrom_t *elite = isl->pop->chroms[isl->best];
+        if (incumbent->num_bins < elite->num_bins) {
+                chrom_copy(elite, incumbent);
+                publish(isl);
         }
 }
 
-result_t *bin_packing(const prob_set_t *ps) {
+/** Sets up the steady-state pipeline of isl around its population */
+static void steady_setup(island_t *isl) {
+        const prob_set_t *ps = isl->run->ps;
+        size_t pop_size = ps->population_size;
+        /* enough tasks for no worker to wait on the island's thread; a
+         * task holds at most three members outside the population, so
+         * there are always members for the free tasks */
+        size_t num_breeds = 2 * isl->num_workers;
+        size_t num_members = pop_size + (3 * num_breeds);
+        isl->ctx.tasks = queue_new(num_breeds);
+        isl->ctx.born = queue_new(num_breeds);
+        isl->ctx.recycle = queue_new(num_members);
+        atomic_init(&isl->ctx.halt, false);
+        member_t *members = arena_alloc(isl->arena,
+                                        num_members * sizeof(*members));
+        breed_t *breeds = arena_alloc(isl->arena,
+                                      num_breeds * sizeof(*breeds));
+        isl->slots = arena_alloc(isl->arena, pop_size * sizeof(*isl->slots));
+        isl->free_members = arena_alloc(isl->arena,
+                                        num_members
+                                        * sizeof(*isl->free_members));
+        isl->free_breeds = arena_alloc(isl->arena,
+                                       num_breeds * sizeof(*isl->free_breeds));
+        isl->num_free_members = 0;
+        for (size_t i=0; i<num_members; i++) {
+                if (i < pop_size) {
+                        members[i].chrom = isl->pop->chroms[i];
+                        atomic_init(&members[i].refs, 1);
+                        isl->slots[i] = &members[i];
+                } else {
+                        members[i].chrom = chrom_alloc(isl->arena,
+                                                       ps->num_items);
+                        atomic_init(&members[i].refs, 0);
+                        isl->free_members[isl->num_free_members++] =
+                                &members[i];
+                }
+        }
+        for (size_t i=0; i<num_breeds; i++) {
+                isl->free_breeds[i] = &breeds[i];
+        }
+        isl->num_free_breeds = num_breeds;
+        isl->in_flight = 0;
+}
+/** Tops up the tasks of isl with parents from its population */
+static void steady_feed(island_t *isl) {
+        const prob_set_t *ps = isl->run->ps;
+        rng_t *rng = &isl->workers[0].ws->rng;
+        void *m;
+        while (queue_pop(isl->ctx.recycle, &m)) {
+                isl->free_members[isl->num_free_members++] = m;
+        }
+        while ((isl->num_free_breeds > 0) && (isl->num_free_members > 0)) {
+                breed_t *b = isl->free_breeds[--isl->num_free_breeds];
+                b->child = isl->free_members[--isl->num_free_members];
+                atomic_store_explicit(&b->child->refs, 1,
+                                      memory_order_relaxed);
+                size_t p1 = tournament_pick(rng, isl->pop,
+                                            ps->tournament_size);
+                size_t p2 = tournament_pick(rng, isl->pop,
+                                            ps->tournament_size);
+                b->parent1 = isl->slots[p1];
+                b->parent2 = isl->slots[p2];
+                /* the slots hold them, so they cannot be recycled now */
+                atomic_fetch_add_explicit(&b->parent1->refs, 1,
+                                          memory_order_relaxed);
+                atomic_fetch_add_explicit(&b->parent2->refs, 1,
+                                          memory_order_relaxed);
+                /* cannot fail: it holds every task */
+                queue_push(isl->ctx.tasks, b);
+                isl->in_flight++;
+        }
+}
+/** Puts the child of b in place of the worst chromosome of isl if it is
+ * fitter */
+static void steady_integrate(island_t *isl, breed_t *b) {
+        pop_t *pop = isl->pop;
+        member_t *child = b->child;
+        isl->free_breeds[isl->num_free_breeds++] = b;
+        isl->in_flight--;
+        size_t worst = find_worst(pop);
+        if (child->chrom->fitness <= pop->chroms[worst]->fitness) {
+                member_release(&isl->ctx, child);
+                return;
+        }
+        member_t *old = isl->slots[worst];
+        isl->slots[worst] = child;
+        pop->chroms[worst] = child->chrom;
+        member_release(&isl->ctx, old);
+        if (child->chrom->fitness > pop->chroms[isl->best]->fitness) {
+                isl->best = worst;
+        }
+}
+/** Takes in the next child of isl to be born, breeding it on this thread
+ * if no worker has taken it; returns false if none is being bred */
+static bool steady_next(island_t *isl) {
+        if (isl->in_flight == 0) {
+                return false;
+        }
+        void *b;
+        for (;;) {
+                if (queue_pop(isl->ctx.born, &b)) {
+                        break;
+                }
+                if (queue_pop(isl->ctx.tasks, &b)) {
+                        breed_child(&isl->workers[0], b);
+                        break;
+                }
+                sched_yield();
+        }
+        steady_integrate(isl, b);
+        return true;
+}
+/** Takes in births children, keeping the pipeline of isl full */
+static void steady_births(island_t *isl, size_t births) {
+        for (size_t i=0; i<births; i++) {
+                steady_feed(isl);
+                steady_next(isl);
+        }
+}
+/** Takes in every child being bred, so that no worker reads the
+ * population of isl */
+static void steady_drain(island_t *isl) {
+        while (steady_next(isl)) {
+        }
+}
+
+/** Sets up the workers and the first population of isl */
+static void island_setup(island_t *isl) {
+        const prob_set_t *ps = isl->run->ps;
+        /* every worker makes at least one child */
+        size_t num_children = ps->population_size - 1;
+        size_t num_workers = ps->num_workers;
+        if (num_workers > num_children) {
+                num_workers = num_children;
+        }
+        if (num_workers == 0) {
+                num_workers = 1;
+        }
+        /* two population buffers swap roles every generation, so after
+         * this setup a generation allocates nothing; the workspaces'
+         * scratch arenas are only rewound */
+        isl->arena = arena_new(ARENA_BLOCK_SZ);
+        isl->ctx = (gen_ctx_t){.ps = ps, .stop = false};
+        isl->num_workers = num_workers;
+        isl->workers = arena_alloc(isl->arena,
+                                   num_workers * sizeof(*isl->workers));
+        uint64_t island_seed = ps->seed ^ (isl->index * ISLAND_SEED_MIX);
+        for (size_t w=0; w<num_workers; w++) {
+                uint64_t seed = island_seed ^ (w * WORKER_SEED_MIX);
+                isl->workers[w] = (worker_t){
+                        .ctx = &isl->ctx,
+                        .ws = chrom_ws_new(ps->num_items, ps->fitness_k,
+                                           ps->repair, ps->use_dominance,
+                                           seed),
+                        .lo = 1 + (w * num_children / num_workers),
+                        .hi = 1 + ((w + 1) * num_children / num_workers)};
+        }
+        isl->ctx.sizes = sizes_new(isl->arena, ps->item_sizes,
+                                   ps->num_items, ps->bin_capacity);
+        isl->pop = pop_rand_init(isl->arena, isl->workers[0].ws,
+                                 ps->population_size, isl->ctx.sizes);
+        isl->best = find_elite(isl->pop);
+        isl->offered = SIZE_MAX;
+        publish(isl);
+        if (ps->steady_state) {
+                steady_setup(isl);
+        }
+        if (num_workers > 1) {
+                if (!ps->steady_state) {
+                        pthread_barrier_init(&isl->ctx.start, NULL,
+                                             num_workers);
+                        pthread_barrier_init(&isl->ctx.done, NULL,
+                                             num_workers);
+                }
+                for (size_t w=1; w<num_workers; w++) {
+                        pthread_create(&isl->workers[w].thread, NULL,
+                                       worker_main, &isl->workers[w]);
+                }
+        }
+}
+/** Evolves the population of isl until the run ends */
+static void island_run(island_t *isl) {
+        bp_run_t *run = isl->run;
+        const prob_set_t *ps = run->ps;
+        chrom_ws_t *ws = isl->workers[0].ws;
+        /* only island 0 reports, so that the lines do not interleave */
+        bool print = !ps->results_only && (isl->index == 0);
+        FILE *out = (ps->out != NULL) ? ps->out : stdout;
+        size_t target = board_target(ps);
+        pop_t *child = NULL;
+        tourn_t *t = NULL;
+        if (!ps->steady_state) {
+                child = pop_alloc_chroms(isl->arena, ps->population_size,
+                                         ps->num_items);
+                t = pop_alloc(isl->arena, ps->mating_pool_size);
+                isl->ctx.mating_pool = t;
+        }
+        double end = now_secs();
+        if (print) {
+                print_stats(out, 1, isl->pop->chroms[isl->best],
+                            end - run->start);
+        }
+        for (size_t gen=1; gen<ps->max_generations; gen++) {
+                const chrom_t *best_chrom = isl->pop->chroms[isl->best];
+                if ((best_chrom->fitness >= nextafter(1.0, 0.0))
+                    || (best_chrom->num_bins <= ps->terminal_num_bins)) {
+                        atomic_store_explicit(&run->solved, true,
+                                              memory_order_relaxed);
+                        break;
+                }
+                if ((end >= run->deadline)
+                    || atomic_load_explicit(&run->cancelled,
+                                            memory_order_relaxed)
+                    || atomic_load_explicit(&run->solved,
+                                            memory_order_relaxed)) {
+                        break;
+                }
+                if (board_reached(ps->board, target)) {
+                        /* no worker may be reading the elite */
+                        if (ps->steady_state) {
+                                steady_drain(isl);
+                        }
+                        take_incumbent(isl);
+                        break;
+                }
+                if (ps->steady_state) {
+                        /* a generation's worth of births */
+                        steady_births(isl, ps->population_size - 1);
+                } else {
+                        tournament_select(&ws->rng, t, isl->pop,
+                                          ps->tournament_p,
+                                          ps->tournament_size);
+                        keep_elite(child, isl->pop, isl->best);
+                        isl->ctx.child = child;
+                        size_t new_best = make_children(isl->workers,
+                                                        isl->num_workers);
+                        /* the parents are overwritten by the next
+                         * generation */
+                        pop_t *tmp = isl->pop;
+                        isl->pop = child;
+                        child = tmp;
+                        isl->best = new_best;
+                }
+                end = now_secs();
+                if (print) {
+                        print_stats(out, gen + 1, isl->pop->chroms[isl->best],
+                                    end - run->start);
+                }
+#ifdef DEBUG_BIN
+                print_chrom(isl->ctx.sizes, isl->pop->chroms[isl->best]);
+#endif
+                bool migrating = (run->num_islands > 1)
+                                 && (gen % ps->migration_interval == 0);
+                bool adopting = ps->adopt_incumbent
+                                && (gen % ps->migration_interval == 0);
+                /* migrants are copied over chromosomes in place */
+                if (ps->steady_state && (migrating || adopting)) {
+                        steady_drain(isl);
+                }
+                if (migrating) {
+                        migrate(isl);
+                }
+                if (adopting) {
+                        adopt(isl);
+                }
+                const chrom_t *elite = isl->pop->chroms[isl->best];
+                if (elite->fitness > isl->published) {
+                        publish(isl);
+                }
+                if ((ps->board != NULL) && (elite->num_bins < isl->offered)) {
+                        isl->offered = elite->num_bins;
+                        board_offer(ps->board, elite);
+                }
+        }
+}
+/** Sends the workers of isl home; its population stays */
+static void island_stop(island_t *isl) {
+        if (isl->run->ps->steady_state) {
+                steady_drain(isl);
+                atomic_store_explicit(&isl->ctx.halt, true,
+                                      memory_order_release);
+                for (size_t w=1; w<isl->num_workers; w++) {
+                        pthread_join(isl->workers[w].thread, NULL);
+                }
+                queue_free(isl->ctx.tasks);
+                queue_free(isl->ctx.born);
+                queue_free(isl->ctx.recycle);
+        } else if (isl->num_workers > 1) {
+                isl->ctx.stop = true;
+                pthread_barrier_wait(&isl->ctx.start);
+                for (size_t w=1; w<isl->num_workers; w++) {
+                        pthread_join(isl->workers[w].thread, NULL);
+                }
+                pthread_barrier_destroy(&isl->ctx.start);
+                pthread_barrier_destroy(&isl->ctx.done);
+        }
+}
+static void *island_main(void *arg) {
+        island_t *isl = arg;
+        island_setup(isl);
+        island_run(isl);
+        island_stop(isl);
+        return NULL;
+}
+
+static bp_run_t *run_new(const prob_set_t *ps) {
         /* verify values before use */
         assert(ps->item_sizes != NULL);
         assert(ps->num_items > 0);
@@ -158,48 +756,150 @@ result_t *bin_packing(const prob_set_t *ps) {
                && (ps->max_mutation_rate <= 1.0));
         assert((ps->tournament_p >= 0.0) && (ps->tournament_p <= 1.0));
         assert(ps->tournament_size > 0);
+        assert(ps->fitness_k > 0);
+        assert((ps->num_islands <= 1) || (ps->migration_interval > 0));
+        assert(!ps->adopt_incumbent
+               || ((ps->board != NULL) && (ps->migration_interval > 0)));
 
-        clock_t start = clock();
+        double start = now_secs();
         if (!ps->results_only) {
-                printf("gen #\t # bins\t fitness\t cum. sec\n");
+                fprintf((ps->out != NULL) ? ps->out : stdout,
+                        "gen #\t # bins\t fitness\t cum. sec\n");
         }
-        pop_t *pop = pop_rand_init(ps->bin_capacity, ps->population_size,
-                                   ps->item_sizes, ps->num_items);
-        const chrom_t *best = find_elite(pop);
-        clock_t end = clock();
-        if (!ps->results_only) {
-                print_stats(1, best, CLOCK2SEC(start, end));
+        arena_t *arena = arena_new(ARENA_BLOCK_SZ);
+        bp_run_t *run = arena_alloc(arena, sizeof(*run));
+        *run = (bp_run_t){.ps = ps,
+                          .start = start,
+                          .deadline = start + ps->max_secs,
+                          .arena = arena,
+                          .num_islands = (ps->num_islands > 0)
+                                         ? ps->num_islands : 1,
+                          .best = chrom_alloc(arena, ps->num_items),
+                          .have_best = false};
+        if ((ps->deadline != NULL)
+            && (timespec_secs(ps->deadline) < run->deadline)) {
+                run->deadline = timespec_secs(ps->deadline);
         }
-        for (size_t gen=1; gen<ps->max_generations; gen++) {
-                if ((best->fitness >= nextafter(1.0, 0.0))
-                    || (best->num_bins <= ps->terminal_num_bins)
-                    || (CLOCK2SEC(start, end) >= ps->max_secs)) {
-                        break;
-                }
-                tourn_t *t = tournament_select(pop, ps->mating_pool_size,
-                                               ps->tournament_p,
-                                               ps->tournament_size);
-                pop_t *child = child_pop(t, ps->population_size, best,
-                                         ps->item_sizes, ps->num_items);
-                tourn_free(t);
-                if (ps->use_inversion_operator) {
-                        inversion(child);
-                }
-                mutate_pop(child, ps->max_mutation_rate,
-                           ps->item_sizes, ps->num_items);
-                const chrom_t *new_best = find_elite(child);
-                end = clock();
-                if (!ps->results_only) {
-                        print_stats(gen + 1, new_best, CLOCK2SEC(start, end));
+        atomic_init(&run->cancelled, false);
+        atomic_init(&run->solved, false);
+        pthread_mutex_init(&run->lock, NULL);
+        pthread_cond_init(&run->published, NULL);
+        /* the mailboxes are all set up before any island can post */
+        run->islands = arena_alloc(arena, run->num_islands
+                                          * sizeof(*run->islands));
+        for (size_t i=0; i<run->num_islands; i++) {
+                run->islands[i] = (island_t){.run = run, .index = i};
+                mailbox_init(&run->islands[i].inbox, arena, ps->num_items);
+        }
+        return run;
+}
+/** Runs the islands of run to the end, island 0 on this thread, unless
+ * the board already has a packing they would stop at */
+static void *run_main(void *arg) {
+        bp_run_t *run = arg;
+        const prob_set_t *ps = run->ps;
+        /* the islands would stop at once on the incumbent */
+        if (board_reached(ps->board, board_target(ps))) {
+                pthread_mutex_lock(&run->lock);
+                chrom_copy(run->best, board_best(ps->board));
+                run->have_best = true;
+                pthread_cond_broadcast(&run->published);
+                pthread_mutex_unlock(&run->lock);
+                return NULL;
+        }
+        for (size_t i=1; i<run->num_islands; i++) {
+                pthread_create(&run->islands[i].thread, NULL, island_main,
+                               &run->islands[i]);
+        }
+        island_main(&run->islands[0]);
+        for (size_t i=1; i<run->num_islands; i++) {
+                pthread_join(run->islands[i].thread, NULL);
+        }
+        for (size_t i=0; i<run->num_islands; i++) {
+                island_t *isl = &run->islands[i];
+                for (size_t w=0; w<isl->num_workers; w++) {
+                        chrom_ws_free(isl->workers[w].ws);
                 }
-#ifdef DEBUG_BIN
-                print_chrom(new_best);
-#endif
-                pop_free(pop);
-                pop = child;
-                best = new_best;
+                arena_free(isl->arena);
+        }
+        return NULL;
+}
+static void run_free(bp_run_t *run) {
+        pthread_cond_destroy(&run->published);
+        pthread_mutex_destroy(&run->lock);
+        arena_free(run->arena);
+}
+
+bp_run_t *bin_packing_start(const prob_set_t *ps) {
+        bp_run_t *run = run_new(ps);
+        pthread_create(&run->thread, NULL, run_main, run);
+        return run;
+}
+void bin_packing_cancel(bp_run_t *run) {
+        atomic_store_explicit(&run->cancelled, true, memory_order_relaxed);
+}
+result_t *bin_packing_best(bp_run_t *run) {
+        pthread_mutex_lock(&run->lock);
+        while (!run->have_best) {
+                pthread_cond_wait(&run->published, &run->lock);
+        }
+        result_t *res = result_alloc(run->best, run->ps->item_sizes,
+                                     run->ps->num_items);
+        pthread_mutex_unlock(&run->lock);
+        return res;
+}
+result_t *bin_packing_wait(bp_run_t *run) {
+        pthread_join(run->thread, NULL);
+        result_t *res = bin_packing_best(run);
+        run_free(run);
+        return res;
+}
+result_t *bin_packing(const prob_set_t *ps) {
+        bp_run_t *run = run_new(ps);
+        run_main(run);
+        result_t *res = bin_packing_best(run);
+        run_free(run);
+        return res;
+}
+result_t *bin_packing_heuristic(const prob_set_t *ps, pack_rule_t rule) {
+        assert(ps->item_sizes != NULL);
+        assert(ps->bin_capacity > 0);
+        assert(ps->fitness_k > 0);
+        arena_t *arena = arena_new(ARENA_BLOCK_SZ);
+        const sizes_t *sizes = sizes_new(arena, ps->item_sizes,
+                                         ps->num_items, ps->bin_capacity);
+        if (sizes->kind != SIZE_U32) {
+                arena_free(arena);
+                return NULL;
+        }
+        uint32_t *assign = arena_alloc(arena, ps->num_items
+                                              * sizeof(*assign));
+        size_t num_bins = pack(rule, sizes->u32, ps->num_items,
+                               sizes->cap.i, assign);
+        size_t *counts = arena_calloc(arena, num_bins, sizeof(*counts));
+        uint64_t *fills = arena_calloc(arena, num_bins, sizeof(*fills));
+        for (size_t i=0; i<ps->num_items; i++) {
+                counts[assign[i]]++;
+                fills[assign[i]] += sizes->u32[i];
+        }
+        result_t *res = malloc(offsetof(result_t, bins)
+                               + (num_bins * sizeof(*res->bins)));
+        *res = (result_t){.num_bins = num_bins};
+        double fill_sum = 0;
+        for (size_t b=0; b<num_bins; b++) {
+                res->bins[b] = malloc(offsetof(struct llarray, elems)
+                                      + (counts[b]
+                                         * sizeof(*res->bins[b]->elems)));
+                res->bins[b]->num_elems = 0;
+                fill_sum += pow((double)fills[b] / sizes->cap.i,
+                                ps->fitness_k);
+        }
+        /* each bin lists its items in index order */
+        for (size_t i=0; i<ps->num_items; i++) {
+                struct llarray *arr = res->bins[assign[i]];
+                arr->elems[arr->num_elems++] = ps->item_sizes[i];
         }
-        result_t *res = result_alloc(best, ps->item_sizes, ps->num_items);
-        pop_free(pop);
+        res->fitness = (num_bins > 0) ? fill_sum / num_bins : 0;
+        arena_free(arena);
         return res;
 }
@@ -1,9 +1,22 @@
 #ifndef BIN_PACKING_H
 #define BIN_PACKING_H
 
+#include "chromosome.h"
+#include "board.h"
+#include "pack.h"
+#include <stdio.h>
+#include <time.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
 
+/* where an island sends its elite: the next island, or a random other */
+typedef enum migration migration_t;
+enum migration {
+        MIGRATE_RING,
+        MIGRATE_RANDOM
+};
+
 typedef struct problem_set prob_set_t;
 struct problem_set {
         const long double *item_sizes;
@@ -11,15 +24,55 @@ struct problem_set {
         size_t bin_capacity;
         size_t max_generations;
         size_t terminal_num_bins;
+        /* wall-clock budget of a run; it also stops at deadline, a time on
+         * CLOCK_MONOTONIC, if that is not NULL and comes first */
         double max_secs;
+        const struct timespec *deadline;
         size_t population_size;
         size_t mating_pool_size;
         double max_mutation_rate;
         double tournament_p;
         unsigned tournament_size;
+        /* exponent k of the fitness, the mean of (fill / cap)^k; 2 is
+         * Falkenauer's choice */
+        unsigned fitness_k;
+        /* how items freed by crossover and mutation are reinserted */
+        repair_t repair;
+        /* swap freed items into bins that they make fuller before the
+         * repair, as in Falkenauer's HGGA */
+        bool use_dominance;
+        /* runs with the same seed and parameters are identical */
+        uint64_t seed;
+        /* threads that make the children of a generation, the caller's
+         * included; each draws from its own generator, so a run repeats
+         * only with the same seed and number of workers. 0 means 1 */
+        size_t num_workers;
+        /* independent populations, each on its own thread with its own
+         * workers, that send their elite to another island every
+         * migration_interval generations; the result is the best of
+         * them. With more than one, when migrants arrive depends on
+         * timing, so runs do not repeat. 0 means 1 */
+        size_t num_islands;
+        size_t migration_interval;
+        migration_t migration;
+        /* shared with the concurrent runs on the same problem, if not
+         * NULL: each offers its elite to the board and stops once any
+         * has reached the lower bound or terminal_num_bins, with the
+         * incumbent as its result. With
+         * adopt_incumbent, every migration_interval generations a run
+         * also takes a better incumbent as a migrant. */
+        board_t *board;
+        bool adopt_incumbent;
+        /* breed children one at a time, as the workers free up, each
+         * replacing the worst chromosome at once if it is fitter, rather
+         * than in generations; a generation is then population_size - 1
+         * births. With more than one worker, runs do not repeat. */
+        bool steady_state;
         bool use_inversion_operator;
         /* When true, suppress per-generation stats; only final result should be shown */
         bool results_only;
+        /* where the per-generation stats go; NULL means stdout */
+        FILE *out;
 };
 
 struct llarray {
@@ -35,6 +88,25 @@ struct result {
 
 void result_free(result_t *res);
 
+/* A run in the background. The problem set must outlive it. */
+typedef struct bp_run bp_run_t;
+
+/** Starts solving ps on threads of its own */
+bp_run_t *bin_packing_start(const prob_set_t *ps);
+/** Asks run to stop, from any thread; it does by the end of the current
+ * generation */
+void bin_packing_cancel(bp_run_t *run);
+/** Returns the best packing run has found so far; only waits until the
+ * first population is made */
+result_t *bin_packing_best(bp_run_t *run);
+/** Waits for run to stop, frees it and returns its best packing */
+result_t *bin_packing_wait(bp_run_t *run);
+
+/** Solves ps on this thread and the threads it asks for */
 result_t *bin_packing(const prob_set_t *ps);
+/** Packs ps with one of the heuristics of pack.h instead, on this thread;
+ * of ps, only the problem and fitness_k are used. Returns NULL if the
+ * sizes cannot be scaled to 32-bit integers, which the heuristics need. */
+result_t *bin_packing_heuristic(const prob_set_t *ps, pack_rule_t rule);
 
 #endif /* !BIN_PACKING_H */
@@ -0,0 +1,81 @@
+#include "board.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#define NUM_ITEMS       200
+#define BIN_CAP         100
+#define NUM_THREADS     4
+#define NUM_OFFERS      2000
+
+static board_t *board;
+static const sizes_t *sizes;
+static arena_t *arena;
+
+typedef struct offerer offerer_t;
+struct offerer {
+        pthread_t thread;
+        uint64_t seed;
+        chrom_t *chrom;
+        /* the fewest bins this thread offered */
+        size_t fewest;
+};
+
+static void *offer_all(void *arg) {
+        offerer_t *o = arg;
+        chrom_ws_t *ws = chrom_ws_new(NUM_ITEMS, 2, REPAIR_FF, false,
+                                      o->seed);
+        o->fewest = SIZE_MAX;
+        for (size_t i=0; i<NUM_OFFERS; i++) {
+                rand_first_fit(ws, o->chrom, sizes);
+                if (o->chrom->num_bins < o->fewest) {
+                        o->fewest = o->chrom->num_bins;
+                }
+                board_offer(board, o->chrom);
+        }
+        chrom_ws_free(ws);
+        return NULL;
+}
+
+int main(void) {
+        arena = arena_new(1 << 16);
+        long double item_sizes[NUM_ITEMS];
+        long double total = 0;
+        srand(3);
+        for (size_t i=0; i<NUM_ITEMS; i++) {
+                item_sizes[i] = rand() % (BIN_CAP / 2) + 1;
+                total += item_sizes[i];
+        }
+        sizes = sizes_new(arena, item_sizes, NUM_ITEMS, BIN_CAP);
+        board = board_new(item_sizes, NUM_ITEMS, BIN_CAP);
+        printf("lower bound: %zu (total %.0Lf, cap %d)\n",
+               board_lower_bound(board), total, BIN_CAP);
+        printf("empty board: %d\n", board_best(board) == NULL);
+        offerer_t offerers[NUM_THREADS];
+        for (size_t t=0; t<NUM_THREADS; t++) {
+                offerers[t] = (offerer_t){
+                        .seed = t,
+                        .chrom = chrom_alloc(arena, NUM_ITEMS)};
+                pthread_create(&offerers[t].thread, NULL, offer_all,
+                               &offerers[t]);
+        }
+        size_t fewest = SIZE_MAX;
+        for (size_t t=0; t<NUM_THREADS; t++) {
+                pthread_join(offerers[t].thread, NULL);
+                if (offerers[t].fewest < fewest) {
+                        fewest = offerers[t].fewest;
+                }
+        }
+        const chrom_t *best = board_best(board);
+        printf("incumbent has the fewest bins offered: %d\n",
+               best->num_bins == fewest);
+        size_t count = 0;
+        for (size_t b=0; b<best->num_bins; b++) {
+                count += best->bins[b].count;
+        }
+        printf("incumbent holds every item: %d\n", count == NUM_ITEMS);
+        printf("worse offer taken: %d\n", board_offer(board, best));
+        board_free(board);
+        arena_free(arena);
+        return 0;
+}
@@ -0,0 +1,82 @@
+#include "board.h"
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <math.h>
+
+#define SNAPSHOT_BLOCK_SZ       (1 << 12)
+/* slack for the rounding of the total size, so that the bound is never
+ * one too many */
+#define BOUND_EPS               1e-9L
+
+typedef struct snapshot snapshot_t;
+struct snapshot {
+        arena_t *arena;
+        const chrom_t *chrom;
+        /* every snapshot taken, to free them with the board */
+        snapshot_t *next;
+};
+struct board {
+        size_t lower_bound;
+        _Atomic(snapshot_t *) best;
+        _Atomic(snapshot_t *) all;
+};
+
+board_t *board_new(const long double *item_sizes, size_t num_items,
+                   long double bin_cap) {
+        long double total = 0;
+        for (size_t i=0; i<num_items; i++) {
+                total += item_sizes[i];
+        }
+        board_t *board = malloc(sizeof(*board));
+        board->lower_bound = ceill((total / bin_cap) - BOUND_EPS);
+        atomic_init(&board->best, NULL);
+        atomic_init(&board->all, NULL);
+        return board;
+}
+void board_free(board_t *board) {
+        snapshot_t *snap = atomic_load(&board->all);
+        while (snap != NULL) {
+                snapshot_t *next = snap->next;
+                arena_free(snap->arena);
+                snap = next;
+        }
+        free(board);
+}
+size_t board_lower_bound(const board_t *board) {
+        return board->lower_bound;
+}
+const chrom_t *board_best(const board_t *board) {
+        snapshot_t *snap = atomic_load_explicit(
+                (_Atomic(snapshot_t *) *)&board->best,
+                memory_order_acquire);
+        return (snap != NULL) ? snap->chrom : NULL;
+}
+bool board_offer(board_t *board, const chrom_t *chrom) {
+        snapshot_t *best = atomic_load_explicit(&board->best,
+                                                memory_order_acquire);
+        if ((best != NULL) && (best->chrom->num_bins <= chrom->num_bins)) {
+                return false;
+        }
+        arena_t *arena = arena_new(SNAPSHOT_BLOCK_SZ);
+        chrom_t *copy = chrom_alloc(arena, chrom->num_items);
+        chrom_copy(copy, chrom);
+        snapshot_t *snap = arena_alloc(arena, sizeof(*snap));
+        *snap = (snapshot_t){.arena = arena, .chrom = copy};
+        /* a failed exchange reloads best, to compare again */
+        do {
+                if ((best != NULL)
+                    && (best->chrom->num_bins <= chrom->num_bins)) {
+                        arena_free(arena);
+                        return false;
+                }
+        } while (!atomic_compare_exchange_weak_explicit(
+                         &board->best, &best, snap,
+                         memory_order_acq_rel, memory_order_acquire));
+        /* published: keep it for board_free() */
+        snap->next = atomic_load_explicit(&board->all, memory_order_relaxed);
+        while (!atomic_compare_exchange_weak_explicit(
+                       &board->all, &snap->next, snap,
+                       memory_order_release, memory_order_relaxed)) {
+        }
+        return true;
+}
@@ -0,0 +1,32 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+#include "chromosome.h"
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Lock-free board of the best packing that any of the runs sharing it has
+ * found for one problem, the incumbent. Runs offer their elite when it
+ * needs fewer bins than the incumbent and stop once the incumbent reaches
+ * the problem's lower bound. Every incumbent is an immutable snapshot
+ * that is swapped in with a compare-and-swap and only freed with the
+ * board, so readers copy it without locks. Snapshots are only taken when
+ * the bin count drops, so there are few of them. */
+typedef struct board board_t;
+
+/** Returns a board for the given problem, with its lower bound */
+board_t *board_new(const long double *item_sizes, size_t num_items,
+                   long double bin_cap);
+/** Frees board; no run may be using it */
+void board_free(board_t *board);
+/** Returns the least number of bins any packing can have: the total
+ * size over the capacity, rounded up */
+size_t board_lower_bound(const board_t *board);
+/** Returns the incumbent, or NULL if there is none yet; it stays valid
+ * until the board is freed */
+const chrom_t *board_best(const board_t *board);
+/** Makes a copy of chrom the incumbent if it needs fewer bins than the
+ * current one; returns true if it did */
+bool board_offer(board_t *board, const chrom_t *chrom);
+
+#endif /* !BOARD_H */
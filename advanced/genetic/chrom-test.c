@@ -1,15 +1,29 @@
 #include "chromosome.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
 
 #define ARR_SZ          20
 #define TEST_CAP        1000
 #define MUT_RATE        (0.75)
+#define ARENA_BLOCK_SZ  4096
+#define FITNESS_K       2
+#define SEED            3
+/* problem sizes for the invariant checks: few bins, past the scan of
+ * the first-fit residuals and the crossover bitset, and past 16-bit
+ * item indices */
+#define NUM_CHECK_SIZES 3
+#define CHECK_ROUNDS    3
+#define FITNESS_EPS     1e-9
+#define NUM_REPAIRS     4
+#define NUM_KINDS       3
 
-static void print_bin(const bin_t *bin,
-                      const long double *item_sizes, size_t num_items);
-static void print_chrom(const chrom_t *chrom,
-                        const long double *item_sizes, size_t num_items);
+static void print_bin(const chrom_t *chrom, const bin_t *bin,
+                      const sizes_t *sizes);
+static void print_chrom(const chrom_t *chrom, const sizes_t *sizes);
+static bool check_all(void);
 
 int main(void) {
         srand(3);
@@ -20,64 +34,260 @@ int main(void) {
                 printf("%Lf ", arr[i]);
         }
         putchar('\n');
+        arena_t *arena = arena_new(ARENA_BLOCK_SZ);
+        arena_t *copy_arena = arena_new(ARENA_BLOCK_SZ);
+        chrom_ws_t *ws = chrom_ws_new(ARR_SZ, FITNESS_K, REPAIR_FF, false,
+                                      SEED);
+        sizes_t *sizes = sizes_new(copy_arena, arr, ARR_SZ, TEST_CAP);
         printf("rand\n");
-        chrom_t *chrom = rand_first_fit(arr, ARR_SZ, TEST_CAP);
+        chrom_t *chrom = chrom_alloc(arena, ARR_SZ);
+        rand_first_fit(ws, chrom, sizes);
         printf("chrom 1:\n");
-        print_chrom(chrom, arr, ARR_SZ);
+        print_chrom(chrom, sizes);
         putchar('\n');
         printf("rand\n");
-        chrom_t *chrom2 = rand_first_fit(arr, ARR_SZ, TEST_CAP);
+        chrom_t *chrom2 = chrom_alloc(arena, ARR_SZ);
+        rand_first_fit(ws, chrom2, sizes);
         printf("chrom 2:\n");
-        print_chrom(chrom2, arr, ARR_SZ);
+        print_chrom(chrom2, sizes);
         putchar('\n');
         printf("crossover\n");
-        chrom_t *child = chrom_cx(chrom, chrom2, arr, ARR_SZ);
+        chrom_t *child = chrom_alloc(arena, ARR_SZ);
+        chrom_cx(ws, child, chrom, chrom2, sizes);
         printf("child chrom:\n");
-        print_chrom(child, arr, ARR_SZ);
+        print_chrom(child, sizes);
         putchar('\n');
         printf("mutate child\n");
-        chrom_mutate(child, MUT_RATE, arr, ARR_SZ);
+        chrom_mutate(ws, child, MUT_RATE, sizes);
         printf("mutated chrom:\n");
-        print_chrom(child, arr, ARR_SZ);
+        print_chrom(child, sizes);
         putchar('\n');
         printf("copy chrom\n");
-        chrom_t *copy = chrom_copy(child);
-        printf("free chrom 1\n");
-        chrom_free(chrom);
-        printf("free chrom 2\n");
-        chrom_free(chrom2);
-        printf("free child chrom\n");
-        chrom_free(child);
+        chrom_t *copy = chrom_alloc(copy_arena, ARR_SZ);
+        chrom_copy(copy, child);
+        printf("free chrom 1, chrom 2 and child chrom\n");
+        arena_free(arena);
         printf("copied chrom:\n");
-        print_chrom(copy, arr, ARR_SZ);
+        print_chrom(copy, sizes);
         putchar('\n');
         printf("free copy\n");
-        chrom_free(copy);
+        arena_free(copy_arena);
+        chrom_ws_free(ws);
         free(arr);
+        printf("chrom-test: %s\n", check_all() ? "pass" : "FAIL");
         return 0;
 }
 
-static void print_bin(const bin_t *bin,
-                      const long double *item_sizes, size_t num_items) {
+static void print_bin(const chrom_t *chrom, const bin_t *bin,
+                      const sizes_t *sizes) {
         printf("fill: %Lf\n"
                "count: %zu\n"
                "items:\n",
-               bin->fill, bin->count);
+               sizes_fill(sizes, &bin->fill), bin->count);
         for (size_t i=0; i<bin->count; i++) {
+                size_t index = chrom_item(chrom, bin->start + i);
                 printf("index: %zu\tsize: %Lf\n",
-                       bin->item_indices[i],
-                       item_sizes[bin->item_indices[i]]);
+                       index, sizes->orig[index]);
         }
 }
-static void print_chrom(const chrom_t *chrom,
-                        const long double *item_sizes, size_t num_items) {
+static void print_chrom(const chrom_t *chrom, const sizes_t *sizes) {
         printf("fitness: %lf\n"
                "bin_cap: %Lf\n"
                "num_bins: %zu\n"
                "bins:\n",
-               chrom->fitness, chrom->bin_cap, chrom->num_bins);
+               chrom->fitness, sizes->bin_cap, chrom->num_bins);
         for (size_t i=0; i<chrom->num_bins; i++) {
                 printf("bin %zu:\n", i);
-                print_bin(chrom->bins[i], item_sizes, num_items);
+                print_bin(chrom, &chrom->bins[i], sizes);
         }
 }
+
+/* as sig_add() in chromosome.c */
+static bool sig_has(const uint64_t *sig, size_t item) {
+        unsigned bit = ((uint64_t)item * UINT64_C(0x9E3779B97F4A7C15)) >> 56;
+        return (sig[bit >> 6] >> (bit & 63)) & 1;
+}
+/** Returns true if chrom packs every item once, each bin's fill is the
+ * sum of its items and within the capacity, each bin's signature holds
+ * its items, and the fitness is that of the fills; else says what is
+ * wrong after what */
+static bool check_chrom(const chrom_t *chrom, const sizes_t *sizes,
+                        unsigned fitness_k, const char *what) {
+        size_t num_items = sizes->num_items;
+        bool *seen = calloc(num_items, sizeof(*seen));
+        const char *wrong = NULL;
+        size_t count = 0;
+        double fill_sum = 0;
+        for (size_t b=0; (b < chrom->num_bins) && (wrong == NULL); b++) {
+                const bin_t *bin = &chrom->bins[b];
+                uint64_t fill = 0;
+                long double fill_f = 0;
+                if (bin->count == 0) {
+                        wrong = "empty bin";
+                }
+                for (size_t j=0; (j < bin->count) && (wrong == NULL); j++) {
+                        size_t item = chrom_item(chrom, bin->start + j);
+                        if ((item >= num_items) || seen[item]) {
+                                wrong = "item packed twice";
+                                break;
+                        }
+                        seen[item] = true;
+                        count++;
+                        if (!sig_has(bin->sig, item)) {
+                                wrong = "item missing from signature";
+                        }
+                        if (sizes->kind == SIZE_U32) {
+                                fill += sizes->u32[item];
+                        } else if (sizes->kind == SIZE_U64) {
+                                fill += sizes->u64[item];
+                        } else {
+                                fill_f += sizes->f[item];
+                        }
+                }
+                if (wrong != NULL) {
+                        break;
+                }
+                if (sizes->kind == SIZE_FLOAT) {
+                        /* the operators sum in another order */
+                        if (fabsl(bin->fill.f - fill_f)
+                            > sizes->cap.f * FITNESS_EPS) {
+                                wrong = "fill is not the sum of the items";
+                        } else if (bin->fill.f > sizes->cap.f) {
+                                wrong = "bin over capacity";
+                        }
+                        fill_sum += pow(bin->fill.f / sizes->cap.f,
+                                        fitness_k);
+                } else {
+                        if (bin->fill.i != fill) {
+                                wrong = "fill is not the sum of the items";
+                        } else if (fill > sizes->cap.i) {
+                                wrong = "bin over capacity";
+                        }
+                        fill_sum += pow((double)fill / sizes->cap.i,
+                                        fitness_k);
+                }
+        }
+        if ((wrong == NULL) && (count != num_items)) {
+                wrong = "item not packed";
+        }
+        if ((wrong == NULL) && (fabs(chrom->fitness
+                                     - fill_sum / chrom->num_bins)
+                                > FITNESS_EPS)) {
+                wrong = "fitness is not that of the fills";
+        }
+        if (wrong != NULL) {
+                printf("%s: %s\n", what, wrong);
+        }
+        free(seen);
+        return wrong == NULL;
+}
+/** Fills item_sizes with num_items sizes of the given kind, and returns
+ * their capacity */
+static long double make_sizes(enum size_kind kind, long double *item_sizes,
+                              size_t num_items) {
+        for (size_t i=0; i<num_items; i++) {
+                long double size = rand() % (TEST_CAP / 2) + 1;
+                switch (kind) {
+                case SIZE_U32:
+                        item_sizes[i] = size;
+                        break;
+                case SIZE_U64:
+                        /* past 32 bits */
+                        item_sizes[i] = size * 1e9L;
+                        break;
+                default:
+                        /* thirds cannot be scaled to integers */
+                        item_sizes[i] = size - 1.0L / 3;
+                        break;
+                }
+        }
+        return (kind == SIZE_U64) ? TEST_CAP * 1e9L : TEST_CAP;
+}
+/** Runs the operators with the given repair on sizes for a few rounds
+ * and checks every chromosome they make; returns true if all are valid
+ * and sets *num_bins to the bins of the last */
+static bool check_ops(const sizes_t *sizes, repair_t repair, bool dominance,
+                      const char *what, size_t *num_bins) {
+        size_t num = sizes->num_items;
+        arena_t *arena = arena_new(ARENA_BLOCK_SZ);
+        chrom_ws_t *ws = chrom_ws_new(num, FITNESS_K, repair, dominance,
+                                      SEED);
+        chrom_t *a = chrom_alloc(arena, num);
+        chrom_t *b = chrom_alloc(arena, num);
+        chrom_t *c = chrom_alloc(arena, num);
+        rand_first_fit(ws, a, sizes);
+        rand_first_fit(ws, b, sizes);
+        bool ok = check_chrom(a, sizes, FITNESS_K, what)
+                  && check_chrom(b, sizes, FITNESS_K, what);
+        for (size_t i=0; (i < CHECK_ROUNDS) && ok; i++) {
+                /* inversion leaves the bins out of item order, in either
+                 * parent */
+                chrom_t *inverted = (i % 2 == 0) ? b : a;
+                chrom_sort_bins(inverted, sizes);
+                ok = check_chrom(inverted, sizes, FITNESS_K, what);
+                chrom_cx(ws, c, a, b, sizes);
+                ok = ok && check_chrom(c, sizes, FITNESS_K, what);
+                /* and the chromosome being mutated */
+                if (i % 2 == 1) {
+                        chrom_sort_bins(c, sizes);
+                        ok = ok && check_chrom(c, sizes, FITNESS_K, what);
+                }
+                chrom_mutate(ws, c, MUT_RATE, sizes);
+                ok = ok && check_chrom(c, sizes, FITNESS_K, what);
+                /* the child breeds with the fitter parent next */
+                chrom_t *old = b;
+                b = a;
+                a = c;
+                c = old;
+        }
+        *num_bins = a->num_bins;
+        chrom_ws_free(ws);
+        arena_free(arena);
+        return ok;
+}
+/** Runs the operators over random problems of every size kind and
+ * size, with every repair, with and without dominance; returns true if
+ * every chromosome they make is valid */
+static bool check_all(void) {
+        static const size_t num_items[NUM_CHECK_SIZES] = {
+                300, 6000, (size_t)UINT16_MAX + 5000};
+        static const char *kinds[NUM_KINDS] = {
+                [SIZE_U32] = "u32", [SIZE_U64] = "u64",
+                [SIZE_FLOAT] = "float"};
+        static const char *repairs[NUM_REPAIRS] = {
+                [REPAIR_FF] = "ff", [REPAIR_FFD] = "ffd",
+                [REPAIR_BF] = "bf", [REPAIR_BFD] = "bfd"};
+        bool ok = true;
+        for (enum size_kind k=0; k<NUM_KINDS; k++) {
+                for (size_t n=0; n<NUM_CHECK_SIZES; n++) {
+                        size_t num = num_items[n];
+                        long double *item_sizes = malloc(
+                                num * sizeof(*item_sizes));
+                        long double cap = make_sizes(k, item_sizes, num);
+                        arena_t *arena = arena_new(ARENA_BLOCK_SZ);
+                        const sizes_t *sizes = sizes_new(arena, item_sizes,
+                                                         num, cap);
+                        bool case_ok = (sizes->kind == k);
+                        size_t num_bins = 0;
+                        for (repair_t r=0; r<NUM_REPAIRS; r++) {
+                                for (int dom=0; dom<2; dom++) {
+                                        char what[64];
+                                        snprintf(what, sizeof(what),
+                                                 "%s %zu %s%s", kinds[k],
+                                                 num, repairs[r],
+                                                 dom ? " dominance" : "");
+                                        case_ok = check_ops(sizes, r, dom,
+                                                            what, &num_bins)
+                                                  && case_ok;
+                                }
+                        }
+                        printf("%s sizes, %zu items, about %zu bins: %s\n",
+                               kinds[k], num, num_bins,
+                               case_ok ? "valid" : "INVALID");
+                        ok = ok && case_ok;
+                        arena_free(arena);
+                        free(item_sizes);
+                }
+        }
+        return ok;
+}
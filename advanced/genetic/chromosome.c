@@ -4,217 +4,1228 @@
 #include <stdbool.h>
 #include <math.h>
 #include <assert.h>
+#include <inttypes.h>
+#if defined (__x86_64__) || defined (__i386__)
+#include <immintrin.h>
+#define HAVE_X86
+#endif
 #if defined (DEBUG) || defined (DEBUG_CX)
 #include <stdio.h>
-static void print_bin(const bin_t *bin) {
-        printf("fill: %lld\n"
+static void print_bin(const sizes_t *sizes, const chrom_t *chrom,
+                      const bin_t *bin) {
+        printf("fill: %Lf\n"
                "count: %zu\n"
                "item_indices:\n",
-               bin->fill, bin->count);
+               sizes_fill(sizes, &bin->fill), bin->count);
         for (size_t i=0; i<bin->count; i++) {
-                printf("%zu ", bin->item_indices[i]);
+                printf("%zu ", chrom_item(chrom, bin->start + i));
         }
         putchar('\n');
 }
-static void print_chrom(const chrom_t *chrom) {
+static void print_chrom(const sizes_t *sizes, const chrom_t *chrom) {
         printf("fitness: %lf\n"
                "bin_cap: %Lf\n"
                "num_bins: %zu\n"
                "bins:\n",
-               chrom->fitness, chrom->bin_cap, chrom->num_bins);
+               chrom->fitness, sizes->bin_cap, chrom->num_bins);
         for (size_t i=0; i<chrom->num_bins; i++) {
                 printf("bin %zu:\n", i);
-                print_bin(chrom->bins[i]);
+                print_bin(sizes, chrom, &chrom->bins[i]);
         }
 }
 #endif
 
-#define FITNESS_K       2
+#define WS_BLOCK_SZ     (1 << 16)
+/* crossover switches from the stamp array to the bitset here */
+#ifndef CX_BITSET_MIN_ITEMS
+#define CX_BITSET_MIN_ITEMS     4096
+#endif
+/* first-fit scans the residuals up to this many bins (open or still to
+ * be opened), and walks a tree above it */
+#ifndef FF_SCAN_MAX_BINS
+#define FF_SCAN_MAX_BINS        1024
+#endif
+/* the scan reads residuals in blocks of this many */
+#define FF_SCAN_BLOCK   16
+/* dominance repair tries pairs of items only in bins of up to this many
+ * items, as their number grows with the square of the count */
+#ifndef DOM_PAIR_MAX_ITEMS
+#define DOM_PAIR_MAX_ITEMS      16
+#endif
 
+/* runs stmt with item set to each item of bin, in order; there is one
+ * loop per index width so the width is not branched on per item */
+#define FOR_BIN_ITEMS(chrom, bin, item, stmt)                           \
+        do {                                                            \
+                if ((chrom)->index_kind == INDEX_U16) {                 \
+                        const uint16_t *items_ = (chrom)->u16           \
+                                                 + (bin)->start;        \
+                        for (size_t i_=0; i_<(bin)->count; i_++) {      \
+                                size_t item = items_[i_];               \
+                                stmt;                                   \
+                        }                                               \
+                } else {                                                \
+                        const uint32_t *items_ = (chrom)->u32           \
+                                                 + (bin)->start;        \
+                        for (size_t i_=0; i_<(bin)->count; i_++) {      \
+                                size_t item = items_[i_];               \
+                                stmt;                                   \
+                        }                                               \
+                }                                                       \
+        } while (0)
 
-static bin_t *bin_alloc(void) {
-        bin_t *bin = malloc(sizeof(*bin));
-        *bin = (bin_t){.fill = 0,
-                       .count = 0,
-                       .item_indices = NULL};
-        return bin;
-}
-static void bin_free(bin_t *bin) {
-        if (bin == NULL) {
-                return;
+static inline size_t index_size(index_kind_t kind) {
+        return (kind == INDEX_U16) ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+static inline uint32_t items_get(index_kind_t kind, const void *items,
+                                 size_t pos) {
+        if (kind == INDEX_U16) {
+                return ((const uint16_t *)items)[pos];
+        }
+        return ((const uint32_t *)items)[pos];
+}
+static inline void items_set(index_kind_t kind, void *items, size_t pos,
+                             uint32_t item) {
+        if (kind == INDEX_U16) {
+                ((uint16_t *)items)[pos] = item;
+        } else {
+                ((uint32_t *)items)[pos] = item;
         }
-        free(bin->item_indices);
-        free(bin);
-}
-static bin_t *bin_copy(const bin_t *bin) {
-        bin_t *copy = bin_alloc();
-        *copy = (bin_t){.fill = bin->fill,
-                        .count = bin->count,
-                        .item_indices = malloc(bin->count
-                                               * sizeof(*bin->item_indices))
-                       };
-        memcpy(copy->item_indices,
-               bin->item_indices,
-               bin->count * sizeof(*copy->item_indices));
-        return copy;
-}
-static void bin_add(bin_t *bin, size_t index, long double value) {
-        bin->fill += value;
-        bin->item_indices = realloc(bin->item_indices,
-                                    (bin->count + 1)
-                                    * sizeof(*bin->item_indices));
-        bin->item_indices[bin->count] = index;
-        bin->count++;
 }
 
-static chrom_t *chrom_alloc(long double bin_cap) {
-        chrom_t *chrom = malloc(sizeof(*chrom));
+chrom_t *chrom_alloc(arena_t *arena, size_t num_items) {
+        assert(num_items <= (size_t)UINT32_MAX + 1);
+        index_kind_t kind = (num_items <= (size_t)UINT16_MAX + 1) ? INDEX_U16
+                                                                  : INDEX_U32;
+        chrom_t *chrom = arena_alloc(arena, sizeof(*chrom));
+        bin_t *bins = arena_alloc(arena, num_items * sizeof(*bins));
+        void *items = arena_alloc(arena, num_items * index_size(kind));
         *chrom = (chrom_t){.fitness = 0,
-                           .bin_cap = bin_cap,
+                           .fill_sum = 0,
+                           .num_items = num_items,
                            .num_bins = 0,
-                           .bins = NULL};
+                           .index_kind = kind,
+                           .bins = bins,
+                           .items = items};
         return chrom;
 }
-static void chrom_new_bin(chrom_t *chrom) {
-        chrom->bins = realloc(chrom->bins,
-                              (chrom->num_bins + 1)
-                              * sizeof(*chrom->bins));
-        chrom->bins[chrom->num_bins] = bin_alloc();
-        chrom->num_bins++;
+/** Returns a bin's share of the fitness sum: its fill ratio to the k.
+ * The usual exponents are multiplies; only others pay for pow(). */
+static inline double fill_term(unsigned k, double ratio) {
+        switch (k) {
+        case 1:
+                return ratio;
+        case 2:
+                return ratio * ratio;
+        case 3:
+                return ratio * ratio * ratio;
+        case 4: {
+                double sq = ratio * ratio;
+                return sq * sq;
+        }
+        default:
+                return pow(ratio, k);
+        }
 }
-static void chrom_add_bin(chrom_t *chrom, bin_t *bin) {
-        chrom_new_bin(chrom);
-        bin_free(chrom->bins[chrom->num_bins - 1]);
-        chrom->bins[chrom->num_bins - 1] = bin;
-}
-static void chrom_del_bin(chrom_t *chrom, size_t bin_index) {
-        bin_free(chrom->bins[bin_index]);
-        memcpy(chrom->bins + bin_index,
-               chrom->bins + bin_index + 1,
-               sizeof(*chrom->bins) * (chrom->num_bins - (bin_index + 1)));
-        /* chrom->bins = realloc(chrom->bins,
-         *                       sizeof(*chrom->bins)
-         *                       * (chrom->num_bins - 1)); */
-        chrom->num_bins--;
-}
-static void eval_fitness(chrom_t *chrom, int fitness_k) {
-        chrom->fitness = 0;
-        for (size_t i=0; i<chrom->num_bins; i++) {
-                chrom->fitness += pow((double)chrom->bins[i]->fill
-                                      / chrom->bin_cap,
-                                      fitness_k)
-                                  / chrom->num_bins;
+static inline double int_term(unsigned k, uint64_t fill, uint64_t cap) {
+        return fill_term(k, (double)fill / cap);
+}
+static inline double float_term(unsigned k, long double fill,
+                                long double cap) {
+        return fill_term(k, fill / cap);
+}
+static inline double bin_term(const chrom_ws_t *ws, const sizes_t *sizes,
+                              const bin_t *bin) {
+        if (sizes->kind == SIZE_FLOAT) {
+                return float_term(ws->fitness_k, bin->fill.f, sizes->cap.f);
         }
+        return int_term(ws->fitness_k, bin->fill.i, sizes->cap.i);
+}
+/** Sets the fitness from the fill sum kept up to date by the operators */
+static inline void update_fitness(chrom_t *chrom) {
+        chrom->fitness = (chrom->num_bins > 0)
+                         ? chrom->fill_sum / chrom->num_bins
+                         : 0;
 }
 
-static void fit(chrom_t *chrom, size_t index, long double value) {
-        for (size_t i=0; i<chrom->num_bins; i++) {
-                if (chrom->bins[i]->fill + value <= chrom->bin_cap) {
+static void chrom_add_bin(const chrom_ws_t *ws, const sizes_t *sizes,
+                          chrom_t *chrom, const bin_t *bin) {
+        chrom->bins[chrom->num_bins] = *bin;
+        chrom->num_bins++;
+        chrom->fill_sum += bin_term(ws, sizes, bin);
+}
+/** Adds value to the fill of bin i, opening it if it is the next bin.
+ * The item itself is written out by layout(). */
+static void bin_add_int(const chrom_ws_t *ws, const sizes_t *sizes,
+                        chrom_t *chrom, size_t i, uint64_t value) {
+        uint64_t cap = sizes->cap.i;
+        if (i < chrom->num_bins) {
 #ifdef DEBUG
-                        printf("adding to bin %zu:\n"
-                               "index: %zu\tsize: %lld\n",
-                               i, index, value);
+                printf("adding to bin %zu:\n"
+                       "size: %" PRIu64 "\n",
+                       i, value);
 #endif
-                        bin_add(chrom->bins[i], index, value);
-                        return;
-                }
+                uint64_t fill = chrom->bins[i].fill.i;
+                chrom->bins[i].fill.i = fill + value;
+                chrom->fill_sum += int_term(ws->fitness_k, fill + value, cap)
+                                   - int_term(ws->fitness_k, fill, cap);
+                return;
         }
 #ifdef DEBUG
         printf("adding to new bin:\n"
-               "index: %zu\tsize: %lld\n",
-               index, value);
+               "size: %" PRIu64 "\n",
+               value);
 #endif
-        chrom_new_bin(chrom);
-        bin_add(chrom->bins[chrom->num_bins - 1], index, value);
+        assert(i == chrom->num_bins);
+        chrom_add_bin(ws, sizes, chrom, &(bin_t){.fill = {.i = value},
+                                                 .start = 0,
+                                                 .count = 0});
 }
-static void first_fit(chrom_t *chrom, const long double *item_sizes,
-                      bool *is_item_used, size_t num_items,
-                      size_t start_pos) {
-        for (size_t loop = 0, i = start_pos, end = num_items;
-             loop < 2;
-             loop++, i = 0, end = start_pos) {
-                for (; i < end; i++) {
-                        if (!is_item_used[i]) {
-                                fit(chrom, i, item_sizes[i]);
-                                is_item_used[i] = true;
-                        }
+/** bin_add_int() for sizes that could not be scaled to integers */
+static void bin_add_float(const chrom_ws_t *ws, const sizes_t *sizes,
+                          chrom_t *chrom, size_t i, long double value) {
+        long double cap = sizes->cap.f;
+        if (i < chrom->num_bins) {
+#ifdef DEBUG
+                printf("adding to bin %zu:\n"
+                       "size: %Lf\n",
+                       i, value);
+#endif
+                long double fill = chrom->bins[i].fill.f;
+                chrom->bins[i].fill.f = fill + value;
+                chrom->fill_sum += float_term(ws->fitness_k, fill + value,
+                                              cap)
+                                   - float_term(ws->fitness_k, fill, cap);
+                return;
+        }
+#ifdef DEBUG
+        printf("adding to new bin:\n"
+               "size: %Lf\n",
+               value);
+#endif
+        assert(i == chrom->num_bins);
+        chrom_add_bin(ws, sizes, chrom, &(bin_t){.fill = {.f = value},
+                                                 .start = 0,
+                                                 .count = 0});
+}
+/** Adds item to the bin signature sig */
+static inline void sig_add(uint64_t *sig, size_t item) {
+        /* fibonacci hashing spreads runs of consecutive indices out */
+        unsigned bit = ((uint64_t)item * UINT64_C(0x9E3779B97F4A7C15)) >> 56;
+        sig[bit >> 6] |= UINT64_C(1) << (bit & 63);
+}
+/** Sets maybe[i] when the signature of bins[i] intersects sig, i.e. when
+ * bins[i] may hold one of the items sig was built from */
+static void sig_filter_scalar(const bin_t *bins, size_t num_bins,
+                              const uint64_t *sig, bool *maybe) {
+        for (size_t i=0; i<num_bins; i++) {
+                uint64_t any = 0;
+                for (size_t w=0; w<BIN_SIG_WORDS; w++) {
+                        any |= bins[i].sig[w] & sig[w];
                 }
+                maybe[i] = (any != 0);
         }
 }
-chrom_t *rand_first_fit(const long double *item_sizes, size_t num_items,
-                        long double bin_cap) {
-        chrom_t *chrom = chrom_alloc(bin_cap);
-        bool *is_item_used = calloc(num_items, sizeof(*is_item_used));
-        first_fit(chrom, item_sizes, is_item_used, num_items,
-                  rand() % num_items);
-        free(is_item_used);
-        eval_fitness(chrom, FITNESS_K);
-        return chrom;
+#ifdef HAVE_X86
+_Static_assert(BIN_SIG_WORDS * sizeof(uint64_t) == sizeof(__m256i),
+               "a bin signature must fill one AVX2 register");
+__attribute__((target("avx2")))
+static void sig_filter_avx2(const bin_t *bins, size_t num_bins,
+                            const uint64_t *sig, bool *maybe) {
+        __m256i s = _mm256_loadu_si256((const __m256i *)sig);
+        for (size_t i=0; i<num_bins; i++) {
+                __m256i b = _mm256_loadu_si256((const __m256i *)bins[i].sig);
+                maybe[i] = !_mm256_testz_si256(b, s);
+        }
 }
-void chrom_free(chrom_t *chrom) {
-        if (chrom == NULL) {
+#endif
+static void sig_filter(const chrom_ws_t *ws, const bin_t *bins,
+                       size_t num_bins, const uint64_t *sig, bool *maybe) {
+#ifdef HAVE_X86
+        if (ws->have_avx2) {
+                sig_filter_avx2(bins, num_bins, sig, maybe);
                 return;
         }
+#endif
+        sig_filter_scalar(bins, num_bins, sig, maybe);
+}
+
+/** Returns the index of the first residual that is at least value. There
+ * must be one, and res must be padded to a multiple of FF_SCAN_BLOCK
+ * entries, which the vector kernels read whole. */
+static size_t ff_scan_scalar(const uint32_t *res, uint32_t value) {
+        size_t i = 0;
+        while (res[i] < value) {
+                i++;
+        }
+        return i;
+}
+#ifdef HAVE_X86
+#ifdef __SSE2__
+static size_t ff_scan_sse2(const uint32_t *res, uint32_t value) {
+        /* SSE2 only compares signed lanes: flipping the sign bits of both
+         * sides makes that an unsigned compare */
+        const __m128i bias = _mm_set1_epi32(INT32_MIN);
+        __m128i v = _mm_xor_si128(_mm_set1_epi32((int32_t)value), bias);
+        for (size_t i=0; ; i+=4) {
+                __m128i r = _mm_loadu_si128((const __m128i *)(res + i));
+                __m128i lt = _mm_cmpgt_epi32(v, _mm_xor_si128(r, bias));
+                unsigned fits = ~_mm_movemask_ps(_mm_castsi128_ps(lt)) & 0xf;
+                if (fits != 0) {
+                        return i + __builtin_ctz(fits);
+                }
+        }
+}
+#endif
+__attribute__((target("avx2")))
+static size_t ff_scan_avx2(const uint32_t *res, uint32_t value) {
+        __m256i v = _mm256_set1_epi32((int32_t)value);
+        for (size_t i=0; ; i+=8) {
+                __m256i r = _mm256_loadu_si256((const __m256i *)(res + i));
+                /* r >= v exactly when max(r, v) == r */
+                __m256i ge = _mm256_cmpeq_epi32(_mm256_max_epu32(r, v), r);
+                unsigned fits = _mm256_movemask_ps(_mm256_castsi256_ps(ge));
+                if (fits != 0) {
+                        return i + __builtin_ctz(fits);
+                }
+        }
+}
+__attribute__((target("avx512f")))
+static size_t ff_scan_avx512(const uint32_t *res, uint32_t value) {
+        __m512i v = _mm512_set1_epi32((int32_t)value);
+        for (size_t i=0; ; i+=16) {
+                __m512i r = _mm512_loadu_si512(res + i);
+                unsigned fits = _mm512_cmpge_epu32_mask(r, v);
+                if (fits != 0) {
+                        return i + __builtin_ctz(fits);
+                }
+        }
+}
+#endif
+static size_t ff_scan(const chrom_ws_t *ws, const uint32_t *res,
+                      uint32_t value) {
+#ifdef HAVE_X86
+        if (ws->have_avx512) {
+                return ff_scan_avx512(res, value);
+        }
+        if (ws->have_avx2) {
+                return ff_scan_avx2(res, value);
+        }
+#ifdef __SSE2__
+        return ff_scan_sse2(res, value);
+#endif
+#endif
+        return ff_scan_scalar(res, value);
+}
+
+/* First-fit runs on a tree of the bin fills (cf. the segment tree of
+ * heuristics/firstfit/ff.py): node 1 is the root, the children of node j
+ * are 2j and 2j + 1, and leaf i, at leaves + i, holds the fill of bin i.
+ * Every other node holds the least fill below it, so the first bin with
+ * room for an item is found by one walk down from the root. The leaves
+ * past the open bins have fill 0 and stand for the bins still to be
+ * opened, so a walk always ends on a bin, possibly a new one. */
+static size_t fill_tree_leaves(size_t num_bins) {
+        size_t leaves = 1;
+        while (leaves < num_bins) {
+                leaves *= 2;
+        }
+        return leaves;
+}
+static uint64_t *fill_tree_int(arena_t *arena, const chrom_t *chrom,
+                               size_t leaves) {
+        uint64_t *tree = arena_calloc(arena, 2 * leaves, sizeof(*tree));
+        for (size_t i=0; i<chrom->num_bins; i++) {
+                tree[leaves + i] = chrom->bins[i].fill.i;
+        }
+        for (size_t j=leaves-1; j>0; j--) {
+                uint64_t l = tree[2*j], r = tree[2*j + 1];
+                tree[j] = (l < r) ? l : r;
+        }
+        return tree;
+}
+static long double *fill_tree_float(arena_t *arena, const chrom_t *chrom,
+                                    size_t leaves) {
+        long double *tree = arena_calloc(arena, 2 * leaves, sizeof(*tree));
         for (size_t i=0; i<chrom->num_bins; i++) {
-                bin_free(chrom->bins[i]);
+                tree[leaves + i] = chrom->bins[i].fill.f;
+        }
+        for (size_t j=leaves-1; j>0; j--) {
+                long double l = tree[2*j], r = tree[2*j + 1];
+                tree[j] = (l < r) ? l : r;
+        }
+        return tree;
+}
+
+/** Returns the index of the first bin with room for value, opening a new
+ * bin if there is none */
+static size_t fit_int(const chrom_ws_t *ws, const sizes_t *sizes,
+                      chrom_t *chrom, uint64_t *tree, size_t leaves,
+                      uint64_t value) {
+        uint64_t cap = sizes->cap.i;
+        size_t j = 1;
+        while (j < leaves) {
+                /* go right only if no bin on the left has room */
+                j = 2*j + (tree[2*j] + value > cap);
+        }
+        size_t i = j - leaves;
+        bin_add_int(ws, sizes, chrom, i, value);
+        for (tree[j] += value, j /= 2; j > 0; j /= 2) {
+                uint64_t l = tree[2*j], r = tree[2*j + 1];
+                tree[j] = (l < r) ? l : r;
+        }
+        return i;
+}
+/** fit_int() for sizes that could not be scaled to integers */
+static size_t fit_float(const chrom_ws_t *ws, const sizes_t *sizes,
+                        chrom_t *chrom, long double *tree, size_t leaves,
+                        long double value) {
+        long double cap = sizes->cap.f;
+        size_t j = 1;
+        while (j < leaves) {
+                j = 2*j + (tree[2*j] + value > cap);
+        }
+        size_t i = j - leaves;
+        bin_add_float(ws, sizes, chrom, i, value);
+        /* the leaf is set from the bin, so both sums round alike */
+        for (tree[j] = chrom->bins[i].fill.f, j /= 2; j > 0; j /= 2) {
+                long double l = tree[2*j], r = tree[2*j + 1];
+                tree[j] = (l < r) ? l : r;
+        }
+        return i;
+}
+/** Returns the residuals of the bins of chrom, for sizes that fit 32
+ * bits, followed by the full capacity for each of the bins up to slots
+ * that may still be opened */
+static uint32_t *ff_residuals(arena_t *arena, const chrom_t *chrom,
+                              uint32_t cap, size_t slots) {
+        size_t len = (slots + FF_SCAN_BLOCK - 1) / FF_SCAN_BLOCK
+                     * FF_SCAN_BLOCK;
+        uint32_t *res = arena_alloc(arena, len * sizeof(*res));
+        for (size_t i=0; i<chrom->num_bins; i++) {
+                res[i] = cap - chrom->bins[i].fill.i;
+        }
+        for (size_t i=chrom->num_bins; i<len; i++) {
+                res[i] = cap;
+        }
+        return res;
+}
+/** fit_int() on a scan of the residuals from ff_residuals(), which is
+ * cheaper than the tree while there are few bins */
+static size_t fit_scan(const chrom_ws_t *ws, const sizes_t *sizes,
+                       chrom_t *chrom, uint32_t *res, uint32_t value) {
+        size_t i = ff_scan(ws, res, value);
+        res[i] -= value;
+        bin_add_int(ws, sizes, chrom, i, value);
+        return i;
+}
+/** Writes every bin of chrom contiguously into dst: first the bin's
+ * current items, read from srcs[i] (or from chrom->items when srcs is
+ * NULL), then the items placed into it by fit(). dst must not overlap
+ * the sources. */
+static void layout(arena_t *arena, chrom_t *chrom, void *dst,
+                   const void *const *srcs,
+                   const uint32_t *placed, const uint32_t *placed_bins,
+                   size_t num_placed) {
+        arena_mark_t mark = arena_mark(arena);
+        size_t isz = index_size(chrom->index_kind);
+        size_t *added = arena_calloc(arena, chrom->num_bins,
+                                     sizeof(*added));
+        for (size_t i=0; i<num_placed; i++) {
+                added[placed_bins[i]]++;
+        }
+        /* bins that follow each other both in their source and in dst,
+         * e.g. the untouched bins of a parent, are copied as one run */
+        const void *run_src = NULL;
+        size_t run_start = 0, run_pos = 0, run_len = 0;
+        for (size_t i=0, pos=0; i<chrom->num_bins; i++) {
+                bin_t *bin = &chrom->bins[i];
+                const void *src = (srcs == NULL) ? chrom->items : srcs[i];
+                if ((src != run_src) || (bin->start != run_start + run_len)
+                    || (pos != run_pos + run_len)) {
+                        if (run_len > 0) {
+                                memcpy((char *)dst + run_pos * isz,
+                                       (const char *)run_src
+                                       + run_start * isz,
+                                       run_len * isz);
+                        }
+                        run_src = src;
+                        run_start = bin->start;
+                        run_pos = pos;
+                        run_len = 0;
+                }
+                run_len += bin->count;
+                bin->start = pos;
+                pos += bin->count + added[i];
+        }
+        if (run_len > 0) {
+                memcpy((char *)dst + run_pos * isz,
+                       (const char *)run_src + run_start * isz,
+                       run_len * isz);
+        }
+        for (size_t i=0; i<num_placed; i++) {
+                bin_t *bin = &chrom->bins[placed_bins[i]];
+                items_set(chrom->index_kind, dst, bin->start + bin->count,
+                          placed[i]);
+                bin->count++;
+                sig_add(bin->sig, placed[i]);
+        }
+        arena_rewind(arena, mark);
+}
+/** First-fits items in the given order, storing the bin of items[i] in
+ * placed_bins[i] */
+static void place_first_fit(chrom_ws_t *ws, chrom_t *chrom,
+                            const sizes_t *sizes,
+                            const uint32_t *free_items, size_t num_free,
+                            uint32_t *placed_bins) {
+        /* each free item opens at most one bin */
+        size_t slots = chrom->num_bins + num_free;
+        size_t leaves = fill_tree_leaves(slots);
+        /* one loop per size representation, so the fits are inlined */
+        switch (sizes->kind) {
+        case SIZE_U32: {
+                if (slots <= FF_SCAN_MAX_BINS) {
+                        uint32_t *res = ff_residuals(ws->arena, chrom,
+                                                     sizes->cap.i, slots);
+                        for (size_t i=0; i<num_free; i++) {
+                                placed_bins[i] = fit_scan(
+                                        ws, sizes, chrom, res,
+                                        sizes->u32[free_items[i]]);
+                        }
+                        break;
+                }
+                uint64_t *tree = fill_tree_int(ws->arena, chrom, leaves);
+                for (size_t i=0; i<num_free; i++) {
+                        placed_bins[i] = fit_int(ws, sizes, chrom,
+                                                 tree, leaves,
+                                                 sizes->u32[free_items[i]]);
+                }
+                break;
+        }
+        case SIZE_U64: {
+                uint64_t *tree = fill_tree_int(ws->arena, chrom, leaves);
+                for (size_t i=0; i<num_free; i++) {
+                        placed_bins[i] = fit_int(ws, sizes, chrom,
+                                                 tree, leaves,
+                                                 sizes->u64[free_items[i]]);
+                }
+                break;
+        }
+        case SIZE_FLOAT: {
+                long double *tree = fill_tree_float(ws->arena, chrom,
+                                                    leaves);
+                for (size_t i=0; i<num_free; i++) {
+                        placed_bins[i] = fit_float(ws, sizes, chrom,
+                                                   tree, leaves,
+                                                   sizes->f[free_items[i]]);
+                }
+                break;
+        }
         }
-        free(chrom->bins);
-        free(chrom);
 }
 
-chrom_t *chrom_copy(const chrom_t *chrom) {
-        chrom_t *copy = chrom_alloc(chrom->bin_cap);
-        copy->fitness = chrom->fitness;
-        copy->num_bins = chrom->num_bins;
-        copy->bins = malloc(chrom->num_bins * sizeof(*copy->bins));
-        for (size_t i=0; i<copy->num_bins; i++) {
-                copy->bins[i] = bin_copy(chrom->bins[i]);
+typedef struct sized_item sized_item_t;
+struct sized_item {
+        fill_t size;
+        uint32_t item;
+};
+/* decreasing size, ties in index order */
+static int sized_cmp_int(const void *a, const void *b) {
+        const sized_item_t *av = a;
+        const sized_item_t *bv = b;
+        if (av->size.i != bv->size.i) {
+                return (av->size.i < bv->size.i) - (av->size.i > bv->size.i);
         }
-        return copy;
+        return (av->item > bv->item) - (av->item < bv->item);
+}
+static int sized_cmp_float(const void *a, const void *b) {
+        const sized_item_t *av = a;
+        const sized_item_t *bv = b;
+        if (av->size.f != bv->size.f) {
+                return (av->size.f < bv->size.f) - (av->size.f > bv->size.f);
+        }
+        return (av->item > bv->item) - (av->item < bv->item);
 }
 
+/* Best-fit keeps the open bins in a treap (cf. the AVL tree of
+ * heuristics/bestfit/bf.py) ordered by fill, and among equal fills by
+ * decreasing index, so the bin an item best fits is the rightmost one
+ * with room: the fullest, and the first of the fullest. Node i is bin i.
+ * A repair builds the treap from the bins in key order in O(B), giving
+ * the bin at position p the priority TREAP_BUILT plus the trailing zeros
+ * of p + 1, which balances it perfectly. Every bin inserted after that
+ * draws its priority below TREAP_BUILT from the workspace's generator,
+ * so k placements cost O(k log B) in expectation however the fills
+ * follow the bin order; split, merge and erase loop rather than recurse
+ * all the same. */
+#define TREAP_NIL       UINT32_MAX
+#define TREAP_BUILT     (UINT32_C(1) << 31)
+#define TREAP_RADIX_BITS 8
+#define TREAP_RADIX     (1 << TREAP_RADIX_BITS)
+typedef struct treap treap_t;
+struct treap {
+        const sizes_t *sizes;
+        const bin_t *bins;
+        uint32_t root;
+        uint32_t *left;
+        uint32_t *right;
+        uint32_t *prio;
+};
+/** Returns true if bin a orders before bin b */
+static inline bool treap_less(const treap_t *t, uint32_t a, uint32_t b) {
+        const fill_t *fa = &t->bins[a].fill;
+        const fill_t *fb = &t->bins[b].fill;
+        if (t->sizes->kind == SIZE_FLOAT) {
+                if (fa->f != fb->f) {
+                        return fa->f < fb->f;
+                }
+        } else if (fa->i != fb->i) {
+                return fa->i < fb->i;
+        }
+        return a > b;
+}
+/** Splits the subtree at node into the bins before key and the rest */
+static void treap_split(treap_t *t, uint32_t node, uint32_t key,
+                        uint32_t *before, uint32_t *rest) {
+        /* where the next node of either side hangs */
+        while (node != TREAP_NIL) {
+                if (treap_less(t, node, key)) {
+                        *before = node;
+                        before = &t->right[node];
+                        node = t->right[node];
+                } else {
+                        *rest = node;
+                        rest = &t->left[node];
+                        node = t->left[node];
+                }
+        }
+        *before = *rest = TREAP_NIL;
+}
+/** Joins two subtrees, every bin of a ordering before every bin of b */
+static uint32_t treap_merge(treap_t *t, uint32_t a, uint32_t b) {
+        uint32_t root;
+        uint32_t *link = &root;
+        while ((a != TREAP_NIL) && (b != TREAP_NIL)) {
+                if (t->prio[a] > t->prio[b]) {
+                        *link = a;
+                        link = &t->right[a];
+                        a = t->right[a];
+                } else {
+                        *link = b;
+                        link = &t->left[b];
+                        b = t->left[b];
+                }
+        }
+        *link = (a != TREAP_NIL) ? a : b;
+        return root;
+}
+static void treap_insert(treap_t *t, uint32_t node) {
+        uint32_t before, rest;
+        t->left[node] = t->right[node] = TREAP_NIL;
+        treap_split(t, t->root, node, &before, &rest);
+        t->root = treap_merge(t, treap_merge(t, before, node), rest);
+}
+static void treap_erase(treap_t *t, uint32_t node) {
+        uint32_t *link = &t->root;
+        while (*link != node) {
+                link = treap_less(t, node, *link) ? &t->left[*link]
+                                                  : &t->right[*link];
+        }
+        *link = treap_merge(t, t->left[node], t->right[node]);
+}
+/** Returns the first num_bins bins of t in key order, by an LSD radix
+ * sort on the fills, which is stable over the bins taken by decreasing
+ * index; fills that are not integers are sorted by comparison */
+static uint32_t *treap_order(arena_t *arena, const treap_t *t,
+                             size_t num_bins) {
+        uint32_t *order = arena_alloc(arena, num_bins * sizeof(*order));
+        if (t->sizes->kind == SIZE_FLOAT) {
+                sized_item_t *sized = arena_alloc(arena,
+                                                  num_bins * sizeof(*sized));
+                for (size_t i=0; i<num_bins; i++) {
+                        sized[i] = (sized_item_t){.size = t->bins[i].fill,
+                                                  .item = i};
+                }
+                /* the reverse of the key order */
+                qsort(sized, num_bins, sizeof(*sized), sized_cmp_float);
+                for (size_t i=0; i<num_bins; i++) {
+                        order[i] = sized[num_bins - 1 - i].item;
+                }
+                return order;
+        }
+        uint32_t *tmp = arena_alloc(arena, num_bins * sizeof(*tmp));
+        for (size_t i=0; i<num_bins; i++) {
+                order[i] = num_bins - 1 - i;
+        }
+        uint64_t cap = t->sizes->cap.i;
+        for (unsigned shift=0; (shift < 64) && ((cap >> shift) != 0);
+             shift += TREAP_RADIX_BITS) {
+                size_t offset[TREAP_RADIX] = {0};
+                for (size_t i=0; i<num_bins; i++) {
+                        offset[(t->bins[order[i]].fill.i >> shift)
+                               & (TREAP_RADIX - 1)]++;
+                }
+                for (size_t d=0, sum=0; d<TREAP_RADIX; d++) {
+                        size_t count = offset[d];
+                        offset[d] = sum;
+                        sum += count;
+                }
+                for (size_t i=0; i<num_bins; i++) {
+                        tmp[offset[(t->bins[order[i]].fill.i >> shift)
+                                   & (TREAP_RADIX - 1)]++] = order[i];
+                }
+                uint32_t *swap = order;
+                order = tmp;
+                tmp = swap;
+        }
+        return order;
+}
+/** Builds t from the bins in key order, keeping the right spine on a
+ * stack; the spine's priorities strictly decrease, so it fits */
+static void treap_build(treap_t *t, const uint32_t *order, size_t num_bins) {
+        uint32_t spine[64];
+        size_t depth = 0;
+        for (size_t p=0; p<num_bins; p++) {
+                uint32_t node = order[p];
+                t->prio[node] = TREAP_BUILT + __builtin_ctzll(p + 1);
+                t->right[node] = TREAP_NIL;
+                uint32_t below = TREAP_NIL;
+                while ((depth > 0)
+                       && (t->prio[spine[depth - 1]] < t->prio[node])) {
+                        below = spine[--depth];
+                }
+                t->left[node] = below;
+                if (depth > 0) {
+                        t->right[spine[depth - 1]] = node;
+                }
+                spine[depth++] = node;
+        }
+        t->root = (depth > 0) ? spine[0] : TREAP_NIL;
+}
+/** Returns the bin value best fits, or TREAP_NIL if none has room */
+static uint32_t treap_best_int(const treap_t *t, uint64_t cap,
+                               uint64_t value) {
+        uint32_t best = TREAP_NIL;
+        for (uint32_t node = t->root; node != TREAP_NIL; ) {
+                if (t->bins[node].fill.i + value <= cap) {
+                        best = node;
+                        node = t->right[node];
+                } else {
+                        node = t->left[node];
+                }
+        }
+        return best;
+}
+static uint32_t treap_best_float(const treap_t *t, long double cap,
+                                 long double value) {
+        uint32_t best = TREAP_NIL;
+        for (uint32_t node = t->root; node != TREAP_NIL; ) {
+                if (t->bins[node].fill.f + value <= cap) {
+                        best = node;
+                        node = t->right[node];
+                } else {
+                        node = t->left[node];
+                }
+        }
+        return best;
+}
+/** place_first_fit() with best-fit */
+static void place_best_fit(chrom_ws_t *ws, chrom_t *chrom,
+                           const sizes_t *sizes,
+                           const uint32_t *free_items, size_t num_free,
+                           uint32_t *placed_bins) {
+        /* each free item opens at most one bin */
+        size_t slots = chrom->num_bins + num_free;
+        treap_t t = {.sizes = sizes,
+                     .bins = chrom->bins,
+                     .root = TREAP_NIL,
+                     .left = arena_alloc(ws->arena, slots * sizeof(*t.left)),
+                     .right = arena_alloc(ws->arena,
+                                          slots * sizeof(*t.right)),
+                     .prio = arena_alloc(ws->arena,
+                                         slots * sizeof(*t.prio))};
+        treap_build(&t, treap_order(ws->arena, &t, chrom->num_bins),
+                    chrom->num_bins);
+        for (size_t i=0; i<num_free; i++) {
+                fill_t value;
+                sizes_item(sizes, free_items[i], &value);
+                uint32_t bin = (sizes->kind == SIZE_FLOAT)
+                               ? treap_best_float(&t, sizes->cap.f, value.f)
+                               : treap_best_int(&t, sizes->cap.i, value.i);
+                if (bin == TREAP_NIL) {
+                        bin = chrom->num_bins;
+                } else {
+                        /* its key is about to change */
+                        treap_erase(&t, bin);
+                }
+                if (sizes->kind == SIZE_FLOAT) {
+                        bin_add_float(ws, sizes, chrom, bin, value.f);
+                } else {
+                        bin_add_int(ws, sizes, chrom, bin, value.i);
+                }
+                t.prio[bin] = rng_next(&ws->rng) % TREAP_BUILT;
+                treap_insert(&t, bin);
+                placed_bins[i] = bin;
+        }
+}
+
+/** Places the free items in the given order, first-fit or best-fit, then
+ * lays the chromosome out into dst (see layout()). */
+static void pack(chrom_ws_t *ws, chrom_t *chrom, void *dst,
+                 const void *const *srcs, const sizes_t *sizes,
+                 const uint32_t *free_items, size_t num_free,
+                 bool best_fit) {
+        arena_mark_t mark = arena_mark(ws->arena);
+        uint32_t *placed_bins = arena_alloc(ws->arena,
+                                            num_free * sizeof(*placed_bins));
+        if (best_fit) {
+                place_best_fit(ws, chrom, sizes, free_items, num_free,
+                               placed_bins);
+        } else {
+                place_first_fit(ws, chrom, sizes, free_items, num_free,
+                                placed_bins);
+        }
+        layout(ws->arena, chrom, dst, srcs, free_items, placed_bins,
+               num_free);
+        arena_rewind(ws->arena, mark);
+}
+static int index_cmp(const void *a, const void *b) {
+        uint32_t av = *(const uint32_t *)a;
+        uint32_t bv = *(const uint32_t *)b;
+        return (av > bv) - (av < bv);
+}
+static void sort_decreasing(arena_t *arena, const sizes_t *sizes,
+                            uint32_t *items, size_t num_items) {
+        arena_mark_t mark = arena_mark(arena);
+        sized_item_t *sized = arena_alloc(arena,
+                                          num_items * sizeof(*sized));
+        for (size_t i=0; i<num_items; i++) {
+                sized[i].item = items[i];
+                sizes_item(sizes, items[i], &sized[i].size);
+        }
+        qsort(sized, num_items, sizeof(*sized),
+              (sizes->kind == SIZE_FLOAT) ? sized_cmp_float : sized_cmp_int);
+        for (size_t i=0; i<num_items; i++) {
+                items[i] = sized[i].item;
+        }
+        arena_rewind(arena, mark);
+}
+/** Puts the free items in the order the repair strategy places them */
+static void order_free(chrom_ws_t *ws, const sizes_t *sizes,
+                       uint32_t *free_items, size_t num_free) {
+        switch (ws->repair) {
+        case REPAIR_FF:
+        case REPAIR_BF:
+                qsort(free_items, num_free, sizeof(*free_items), index_cmp);
+                break;
+        case REPAIR_FFD:
+        case REPAIR_BFD:
+                sort_decreasing(ws->arena, sizes, free_items, num_free);
+                break;
+        }
+}
+static inline bool repair_best_fit(const chrom_ws_t *ws) {
+        return (ws->repair == REPAIR_BF) || (ws->repair == REPAIR_BFD);
+}
+
+/* Dominance repair, after Falkenauer's HGGA and Martello and Toth's
+ * dominance criterion: before the free items are refit, each bin swaps
+ * one or two of its items for one or two free items whenever that makes
+ * it fuller. The bins fill up, and what is left to refit is smaller.
+ * The free items are kept in decreasing size; they never outnumber the
+ * items first freed, since no swap frees more items than it takes. */
+typedef struct dom_free dom_free_t;
+struct dom_free {
+        size_t num;
+        uint64_t *sizes;
+        uint32_t *items;
+};
+static void dom_free_del(dom_free_t *fr, size_t i) {
+        memmove(fr->sizes + i, fr->sizes + i + 1,
+                (fr->num - (i + 1)) * sizeof(*fr->sizes));
+        memmove(fr->items + i, fr->items + i + 1,
+                (fr->num - (i + 1)) * sizeof(*fr->items));
+        fr->num--;
+}
+static void dom_free_add(dom_free_t *fr, uint64_t size, uint32_t item) {
+        size_t i = fr->num;
+        while ((i > 0) && (fr->sizes[i - 1] < size)) {
+                i--;
+        }
+        memmove(fr->sizes + i + 1, fr->sizes + i,
+                (fr->num - i) * sizeof(*fr->sizes));
+        memmove(fr->items + i + 1, fr->items + i,
+                (fr->num - i) * sizeof(*fr->items));
+        fr->sizes[i] = size;
+        fr->items[i] = item;
+        fr->num++;
+}
+/** Returns the index of the largest free item of at most limit, or
+ * fr->num if there is none */
+static size_t dom_free_one(const dom_free_t *fr, uint64_t limit) {
+        size_t lo = 0, hi = fr->num;
+        while (lo < hi) {
+                size_t mid = lo + (hi - lo) / 2;
+                if (fr->sizes[mid] <= limit) {
+                        hi = mid;
+                } else {
+                        lo = mid + 1;
+                }
+        }
+        return lo;
+}
+/** Returns the largest sum of two free items of at most limit, which are
+ * stored in *a and *b, or 0 if there is no such pair */
+static uint64_t dom_free_two(const dom_free_t *fr, uint64_t limit,
+                             size_t *a, size_t *b) {
+        uint64_t best = 0;
+        if (fr->num < 2) {
+                return 0;
+        }
+        /* big walks down the sizes from the largest, small up from the
+         * smallest */
+        for (size_t big = 0, small = fr->num - 1; big < small; ) {
+                uint64_t sum = fr->sizes[big] + fr->sizes[small];
+                if (sum > limit) {
+                        big++;
+                        continue;
+                }
+                if (sum > best) {
+                        best = sum;
+                        *a = big;
+                        *b = small;
+                        if (sum == limit) {
+                                break;
+                        }
+                }
+                small--;
+        }
+        return best;
+}
+/** Applies the best swap between bin i, whose items are at items +
+ * bin->start, and the free items, until none makes it fuller. Swapping
+ * one item for two grows the bin, so the second one is appended to
+ * placed instead, and the bin is left alone after that. Returns true if
+ * the bin changed. The searches run on a copy of the bin's item sizes in
+ * bin_sizes, which holds room for any bin, so that they neither switch
+ * on the size nor on the index kind. */
+static bool dominate_bin(const chrom_ws_t *ws, chrom_t *chrom,
+                         const sizes_t *sizes, void *items, size_t i,
+                         dom_free_t *fr, uint64_t *bin_sizes,
+                         uint32_t *placed, uint32_t *placed_bins,
+                         size_t *num_placed) {
+        index_kind_t kind = chrom->index_kind;
+        bool changed = false;
+        const bin_t *start = &chrom->bins[i];
+        for (size_t p=0; p<start->count; p++) {
+                uint32_t x = items_get(kind, items, start->start + p);
+                bin_sizes[p] = sizes_int(sizes, x);
+        }
+        while (fr->num > 0) {
+                const bin_t *bin = &chrom->bins[i];
+                uint64_t room = sizes->cap.i - bin->fill.i;
+                if (room == 0) {
+                        break;
+                }
+                uint64_t best = 0;
+                size_t out[2], in[2];
+                unsigned num_out = 0, num_in = 0;
+                bool pairs = (bin->count <= DOM_PAIR_MAX_ITEMS);
+                for (size_t p=0; p<bin->count; p++) {
+                        uint64_t xs = bin_sizes[p];
+                        size_t a, b;
+                        /* 1-1 */
+                        a = dom_free_one(fr, xs + room);
+                        if ((a < fr->num) && (fr->sizes[a] > xs)
+                            && (fr->sizes[a] - xs > best)) {
+                                best = fr->sizes[a] - xs;
+                                num_out = 1, out[0] = p;
+                                num_in = 1, in[0] = a;
+                        }
+                        if (!pairs) {
+                                continue;
+                        }
+                        /* 1-2 */
+                        uint64_t sum = dom_free_two(fr, xs + room, &a, &b);
+                        if ((sum > xs) && (sum - xs > best)) {
+                                best = sum - xs;
+                                num_out = 1, out[0] = p;
+                                num_in = 2, in[0] = a, in[1] = b;
+                        }
+                        /* 2-2 */
+                        for (size_t q=p+1; q<bin->count; q++) {
+                                uint64_t pair = xs + bin_sizes[q];
+                                sum = dom_free_two(fr, pair + room, &a, &b);
+                                if ((sum > pair) && (sum - pair > best)) {
+                                        best = sum - pair;
+                                        num_out = 2, out[0] = p, out[1] = q;
+                                        num_in = 2, in[0] = a, in[1] = b;
+                                }
+                        }
+                        if (best == room) {
+                                break;
+                        }
+                }
+                if (best == 0) {
+                        break;
+                }
+                /* in[0] < in[1], so deleting in[1] first keeps in[0] */
+                uint32_t new_items[2];
+                uint64_t new_sizes[2];
+                for (unsigned j=num_in; j-->0; ) {
+                        new_items[j] = fr->items[in[j]];
+                        new_sizes[j] = fr->sizes[in[j]];
+                        dom_free_del(fr, in[j]);
+                }
+                for (unsigned j=0; j<num_out; j++) {
+                        size_t pos = bin->start + out[j];
+                        dom_free_add(fr, bin_sizes[out[j]],
+                                     items_get(kind, items, pos));
+                        items_set(kind, items, pos, new_items[j]);
+                        bin_sizes[out[j]] = new_sizes[j];
+                }
+                bin_add_int(ws, sizes, chrom, i, best);
+                changed = true;
+                if (num_in > num_out) {
+                        placed[*num_placed] = new_items[1];
+                        placed_bins[*num_placed] = i;
+                        (*num_placed)++;
+                        break;
+                }
+        }
+        return changed;
+}
+/** repair() with dominance swaps ahead of the refit; for integer sizes */
+static void dominance_repair(chrom_ws_t *ws, chrom_t *chrom, void *dst,
+                             const void *const *srcs, const sizes_t *sizes,
+                             uint32_t *free_items, size_t num_free) {
+        arena_mark_t mark = arena_mark(ws->arena);
+        index_kind_t kind = chrom->index_kind;
+        /* the surviving bins are laid out first, so their items can be
+         * swapped in place */
+        void *items = arena_alloc(ws->arena,
+                                  chrom->num_items * index_size(kind));
+        layout(ws->arena, chrom, items, srcs, NULL, NULL, 0);
+        sort_decreasing(ws->arena, sizes, free_items, num_free);
+        dom_free_t fr = {.num = num_free,
+                         .sizes = arena_alloc(ws->arena,
+                                              num_free * sizeof(uint64_t)),
+                         .items = free_items};
+        for (size_t i=0; i<num_free; i++) {
+                fr.sizes[i] = sizes_int(sizes, free_items[i]);
+        }
+        uint32_t *placed = arena_alloc(ws->arena,
+                                       num_free * sizeof(*placed));
+        uint32_t *placed_bins = arena_alloc(ws->arena,
+                                            num_free * sizeof(*placed_bins));
+        uint64_t *bin_sizes = arena_alloc(ws->arena,
+                                          chrom->num_items
+                                          * sizeof(*bin_sizes));
+        size_t num_placed = 0;
+        for (size_t i=0; (i < chrom->num_bins) && (fr.num > 0); i++) {
+                if (!dominate_bin(ws, chrom, sizes, items, i, &fr,
+                                  bin_sizes, placed, placed_bins,
+                                  &num_placed)) {
+                        continue;
+                }
+                bin_t *bin = &chrom->bins[i];
+                memset(bin->sig, 0, sizeof(bin->sig));
+                for (size_t j=0; j<bin->count; j++) {
+                        sig_add(bin->sig,
+                                items_get(kind, items, bin->start + j));
+                }
+        }
+        /* the leftovers are refit with the repair strategy */
+        order_free(ws, sizes, fr.items, fr.num);
+        if (repair_best_fit(ws)) {
+                place_best_fit(ws, chrom, sizes, fr.items, fr.num,
+                               placed_bins + num_placed);
+        } else {
+                place_first_fit(ws, chrom, sizes, fr.items, fr.num,
+                                placed_bins + num_placed);
+        }
+        memcpy(placed + num_placed, fr.items, fr.num * sizeof(*placed));
+        num_placed += fr.num;
+        const void **all = arena_alloc(ws->arena,
+                                       chrom->num_bins * sizeof(*all));
+        for (size_t i=0; i<chrom->num_bins; i++) {
+                all[i] = items;
+        }
+        layout(ws->arena, chrom, dst, all, placed, placed_bins, num_placed);
+        arena_rewind(ws->arena, mark);
+}
+
+/** Reinserts the free items, which it reorders, with the workspace's
+ * repair strategy, then lays the chromosome out into dst */
+static void repair(chrom_ws_t *ws, chrom_t *chrom, void *dst,
+                   const void *const *srcs, const sizes_t *sizes,
+                   uint32_t *free_items, size_t num_free) {
+        if (ws->dominance && (sizes->kind != SIZE_FLOAT) && (num_free > 0)) {
+                dominance_repair(ws, chrom, dst, srcs, sizes,
+                                 free_items, num_free);
+                return;
+        }
+        order_free(ws, sizes, free_items, num_free);
+        pack(ws, chrom, dst, srcs, sizes, free_items, num_free,
+             repair_best_fit(ws));
+}
+
+chrom_ws_t *chrom_ws_new(size_t num_items, unsigned fitness_k,
+                         repair_t repair, bool dominance, uint64_t seed) {
+        assert(fitness_k > 0);
+        arena_t *arena = arena_new(WS_BLOCK_SZ);
+        chrom_ws_t *ws = arena_alloc(arena, sizeof(*ws));
+        ws->arena = arena;
+        rng_seed(&ws->rng, seed);
+        ws->fitness_k = fitness_k;
+        ws->repair = repair;
+        ws->dominance = dominance;
+        item_set_init(&ws->used,
+                      arena_calloc(arena, num_items, sizeof(uint32_t)),
+                      num_items);
+        ws->use_bitset = (num_items >= CX_BITSET_MIN_ITEMS);
+        ws->used_bits = arena_calloc(arena, (num_items + 63) / 64,
+                                     sizeof(*ws->used_bits));
+#ifdef HAVE_X86
+        ws->have_avx2 = __builtin_cpu_supports("avx2");
+        ws->have_avx512 = __builtin_cpu_supports("avx512f");
+#else
+        ws->have_avx2 = false;
+        ws->have_avx512 = false;
+#endif
+        return ws;
+}
+void chrom_ws_free(chrom_ws_t *ws) {
+        if (ws == NULL) {
+                return;
+        }
+        /* ws itself lives in its arena */
+        arena_free(ws->arena);
+}
+
+void rand_first_fit(chrom_ws_t *ws, chrom_t *chrom, const sizes_t *sizes) {
+        size_t num_items = sizes->num_items;
+        assert(chrom->num_items == num_items);
+        chrom->num_bins = 0;
+        chrom->fill_sum = 0;
+        arena_mark_t mark = arena_mark(ws->arena);
+        /* every item, starting at a random one and wrapping around */
+        uint32_t *order = arena_alloc(ws->arena,
+                                      num_items * sizeof(*order));
+        for (size_t i=0, item=rng_below(&ws->rng, num_items); i<num_items;
+             i++) {
+                order[i] = item;
+                item = (item + 1 < num_items) ? item + 1 : 0;
+        }
+        pack(ws, chrom, chrom->items, NULL, sizes, order, num_items, false);
+        arena_rewind(ws->arena, mark);
+        update_fitness(chrom);
+}
+
+void chrom_copy(chrom_t *dst, const chrom_t *src) {
+        assert(dst->num_items == src->num_items);
+        assert(dst->index_kind == src->index_kind);
+        dst->fitness = src->fitness;
+        dst->fill_sum = src->fill_sum;
+        dst->num_bins = src->num_bins;
+        memcpy(dst->bins, src->bins, src->num_bins * sizeof(*dst->bins));
+        memcpy(dst->items, src->items,
+               src->num_items * index_size(src->index_kind));
+}
+
+static inline bool is_used(const chrom_ws_t *ws, size_t item) {
+        if (ws->use_bitset) {
+                return (ws->used_bits[item >> 6] >> (item & 63)) & 1;
+        }
+        return item_set_has(&ws->used, item);
+}
 /** Returns true if used items conflict with items in bin */
-static bool check4conflict(const bool *is_item_used, const bin_t *bin) {
-        for (size_t i=0; i<bin->count; i++) {
-                if (is_item_used[bin->item_indices[i]]) {
+static bool check4conflict(const chrom_ws_t *ws, const chrom_t *chrom,
+                           const bin_t *bin) {
+        FOR_BIN_ITEMS(chrom, bin, item, {
+                if (is_used(ws, item)) {
                         return true;
                 }
-        }
+        });
         return false;
 }
-static void mark_used(bool *is_item_used, const bin_t *bin) {
-        for (size_t i=0; i<bin->count; i++) {
-                is_item_used[bin->item_indices[i]] = true;
+static void mark_used(chrom_ws_t *ws, const chrom_t *chrom,
+                      const bin_t *bin) {
+        if (ws->use_bitset) {
+                FOR_BIN_ITEMS(chrom, bin, item, {
+                        ws->used_bits[item >> 6] |=
+                                UINT64_C(1) << (item & 63);
+                });
+        } else {
+                FOR_BIN_ITEMS(chrom, bin, item,
+                              item_set_add(&ws->used, item));
         }
 }
-static void mark_unused(bool *is_item_used, const bin_t *bin) {
-        for (size_t i=0; i<bin->count; i++) {
-                is_item_used[bin->item_indices[i]] = false;
-        }
+/** Clears the used items of bin from the bitset; the stamp array is
+ * cleared wholesale by item_set_clear() instead */
+static void unmark_bits(chrom_ws_t *ws, const chrom_t *chrom,
+                        const bin_t *bin) {
+        FOR_BIN_ITEMS(chrom, bin, item, ws->used_bits[item >> 6] = 0);
 }
-chrom_t *chrom_cx(const chrom_t *parent1, const chrom_t *parent2,
-                  const long double *item_sizes, size_t num_items) {
+/** Appends the items of bin that are not used to free_items */
+static size_t collect_unused(const chrom_ws_t *ws, const chrom_t *chrom,
+                             const bin_t *bin, uint32_t *free_items,
+                             size_t num_free) {
+        FOR_BIN_ITEMS(chrom, bin, item, {
+                if (!is_used(ws, item)) {
+                        free_items[num_free++] = item;
+                }
+        });
+        return num_free;
+}
+void chrom_cx(chrom_ws_t *ws, chrom_t *child,
+              const chrom_t *parent1, const chrom_t *parent2,
+              const sizes_t *sizes) {
+        size_t num_items = sizes->num_items;
+        assert((child != parent1) && (child != parent2));
+        assert(child->num_items == num_items);
 #ifdef DEBUG_CX
         printf("parent1:\n");
-        print_chrom(parent1);
+        print_chrom(sizes, parent1);
         printf("parent2:\n");
-        print_chrom(parent2);
+        print_chrom(sizes, parent2);
 #endif
-        size_t p2_start = rand() % (parent2->num_bins);
-        size_t p2_count = rand() % (parent2->num_bins - p2_start) + 1;
-        size_t p1_pos = rand() % (parent1->num_bins + 1);
+        size_t p2_start = rng_below(&ws->rng, parent2->num_bins);
+        size_t p2_count = rng_below(&ws->rng, parent2->num_bins - p2_start)
+                          + 1;
+        size_t p1_pos = rng_below(&ws->rng, parent1->num_bins + 1);
 #ifdef DEBUG_CX
         printf("\nparent2 start: %zu\n"
                "parent2 count: %zu\n"
                "parent1 pos: %zu\n\n",
                p2_start, p2_count, p1_pos);
 #endif
-        chrom_t *child = chrom_alloc(parent1->bin_cap);
-        bool *is_item_used = calloc(num_items, sizeof(*is_item_used));
-        /* marking items from the chosen bins from parent2 as used */
+        child->num_bins = 0;
+        child->fill_sum = 0;
+        arena_mark_t mark = arena_mark(ws->arena);
+        /* the parent each of child's bins is copied from */
+        const void **srcs = arena_alloc(ws->arena,
+                                        num_items * sizeof(*srcs));
+        uint32_t *free_items = arena_alloc(ws->arena,
+                                           num_items * sizeof(*free_items));
+        size_t num_free = 0;
+        /* marking items from the chosen bins from parent2 as used; the
+         * bins of parent1 are disjoint, so only these can conflict */
+        uint64_t p2_sig[BIN_SIG_WORDS] = {0};
+        item_set_clear(&ws->used);
         for (size_t i=p2_start; i<p2_start+p2_count; i++) {
-                mark_used(is_item_used, parent2->bins[i]);
+                mark_used(ws, parent2, &parent2->bins[i]);
+                for (size_t w=0; w<BIN_SIG_WORDS; w++) {
+                        p2_sig[w] |= parent2->bins[i].sig[w];
+                }
         }
+        /* only the bins whose signatures meet parent2's need the exact,
+         * item by item check */
+        bool *maybe_conflict = arena_alloc(ws->arena,
+                                           parent1->num_bins
+                                           * sizeof(*maybe_conflict));
+        sig_filter(ws, parent1->bins, parent1->num_bins, p2_sig,
+                   maybe_conflict);
         /* 1.) adding bins w/o conflicts from parent1 prior to p1_pos
          * 2.) adding bins from parent2
          * 3.) adding bins w/o conflicts from parent1 after p1_pos */
@@ -224,16 +1235,22 @@ chrom_t *chrom_cx(const chrom_t *parent1, const chrom_t *parent2,
              loop++, p1i = p1_pos, p1end = parent1->num_bins) {
                 /* 1.) & 3.) */
                 for (; p1i < p1end; p1i++) {
-                        if (!check4conflict(is_item_used,
-                                            parent1->bins[p1i])) {
+                        const bin_t *bin = &parent1->bins[p1i];
+                        if (!maybe_conflict[p1i]
+                            || !check4conflict(ws, parent1, bin)) {
 #ifdef DEBUG
                                 printf("bin %zu in parent1 has no"
                                        " conflicts; adding bin\n",
                                        p1i);
 #endif
-                                chrom_add_bin(child,
-                                              bin_copy(parent1->bins[p1i]));
-                                mark_used(is_item_used, parent1->bins[p1i]);
+                                srcs[child->num_bins] = parent1->items;
+                                chrom_add_bin(ws, sizes, child, bin);
+                        } else {
+                                /* every item of a dropped bin that parent2
+                                 * did not bring along has to be refit */
+                                num_free = collect_unused(ws, parent1, bin,
+                                                          free_items,
+                                                          num_free);
                         }
                 }
                 /* 2.) */
@@ -241,17 +1258,33 @@ chrom_t *chrom_cx(const chrom_t *parent1, const chrom_t *parent2,
 #ifdef DEBUG
                         printf("adding bin %zu from parent2\n", p2i);
 #endif
-                        chrom_add_bin(child, bin_copy(parent2->bins[p2i]));
+                        srcs[child->num_bins] = parent2->items;
+                        chrom_add_bin(ws, sizes, child, &parent2->bins[p2i]);
                 }
         }
-        /* first-fit the items not in any bins in child */
-        first_fit(child, item_sizes, is_item_used, num_items, 0);
-        free(is_item_used);
-        eval_fitness(child, FITNESS_K);
-        return child;
+        /* reinsert the items not in any bins in child, copying the
+         * inherited bins' items straight from the parents */
+        repair(ws, child, child->items, srcs, sizes, free_items, num_free);
+        if (ws->use_bitset) {
+                for (size_t i=p2_start; i<p2_start+p2_count; i++) {
+                        unmark_bits(ws, parent2, &parent2->bins[i]);
+                }
+        }
+        arena_rewind(ws->arena, mark);
+        update_fitness(child);
+}
+/** Returns how many bins mutation skips before deleting the next one, at
+ * most limit: geometric with log_keep = log(1 - mutation rate), so there
+ * is one random draw per deleted bin rather than per bin */
+static size_t mutation_skip(rng_t *rng, double log_keep, size_t limit) {
+        /* u is uniform on (0, 1] so its log is finite */
+        double u = 1.0 - rng_uniform(rng);
+        double skip = log(u) / log_keep;
+        return (skip < (double)limit) ? (size_t)skip : limit;
 }
-void chrom_mutate(chrom_t *chrom, double mutation_rate,
-                  const long double *item_sizes, size_t num_items) {
+void chrom_mutate(chrom_ws_t *ws, chrom_t *chrom, double mutation_rate,
+                  const sizes_t *sizes) {
+        size_t num_items = sizes->num_items;
         assert((mutation_rate >= 0.0) && (mutation_rate <= 1.0));
 #ifdef DEBUG
         printf("mutation_rate: %lf\n", mutation_rate);
@@ -259,28 +1292,65 @@ void chrom_mutate(chrom_t *chrom, double mutation_rate,
         if (mutation_rate == 0.0) {
                 return;
         }
-        bool *is_item_used = malloc(sizeof(*is_item_used) * num_items);
-        for (size_t i=0; i<num_items; i++) {
-                is_item_used[i] = true;
-        }
+        arena_mark_t mark = arena_mark(ws->arena);
+        uint32_t *free_items = arena_alloc(ws->arena,
+                                           num_items * sizeof(*free_items));
+        size_t num_free = 0;
         /* 'mutate' (delete) each bin with a probability specified by the
-         * mutation rate */
-        for (size_t i=0; i<chrom->num_bins; i++) {
-#ifndef DEBUG
-                if (rand() * (1 / (double)RAND_MAX) <= mutation_rate) {
-#else
-                double rand_mut = rand() * (1 / (double)RAND_MAX);
-                printf("randomly generated value: %lf\n", rand_mut);
-                if (rand_mut <= mutation_rate) {
-                        printf("deleting bin %zu\n", i);
+         * mutation rate: the gaps between deleted bins are drawn directly,
+         * and the surviving runs in between are shifted down in one pass.
+         * The items of deleted bins stay behind as holes in chrom->items
+         * until the layout below. */
+        double log_keep = log1p(-mutation_rate);
+        size_t num_bins = chrom->num_bins;
+        size_t kept = 0, next = 0;
+        for (size_t doomed = mutation_skip(&ws->rng, log_keep, num_bins);
+             doomed < num_bins;
+             doomed += 1 + mutation_skip(&ws->rng, log_keep,
+                                         num_bins - doomed)) {
+#ifdef DEBUG
+                printf("deleting bin %zu\n", doomed);
 #endif
-                        mark_unused(is_item_used, chrom->bins[i]);
-                        chrom_del_bin(chrom, i);
-                        i--; // have to account for bins shifting back
+                const bin_t *bin = &chrom->bins[doomed];
+                FOR_BIN_ITEMS(chrom, bin, item,
+                              free_items[num_free++] = item);
+                chrom->fill_sum -= bin_term(ws, sizes, bin);
+                if (kept != next) {
+                        memmove(chrom->bins + kept, chrom->bins + next,
+                                (doomed - next) * sizeof(*chrom->bins));
                 }
+                kept += doomed - next;
+                next = doomed + 1;
         }
-        /* first fit items from deleted bins */
-        first_fit(chrom, item_sizes, is_item_used, num_items, 0);
-        free(is_item_used);
-        eval_fitness(chrom, FITNESS_K);
+        if (kept != next) {
+                memmove(chrom->bins + kept, chrom->bins + next,
+                        (num_bins - next) * sizeof(*chrom->bins));
+        }
+        chrom->num_bins = kept + (num_bins - next);
+        if (num_free > 0) {
+                /* reinsert items from deleted bins into a scratch item
+                 * array, closing the holes left by the deleted bins */
+                size_t isz = index_size(chrom->index_kind);
+                void *items = arena_alloc(ws->arena, num_items * isz);
+                repair(ws, chrom, items, NULL, sizes, free_items, num_free);
+                memcpy(chrom->items, items, num_items * isz);
+        }
+        arena_rewind(ws->arena, mark);
+        update_fitness(chrom);
+}
+
+static int bin_cmp_int(const void *a, const void *b) {
+        const bin_t *av = a;
+        const bin_t *bv = b;
+        return (av->fill.i > bv->fill.i) - (av->fill.i < bv->fill.i);
+}
+static int bin_cmp_float(const void *a, const void *b) {
+        const bin_t *av = a;
+        const bin_t *bv = b;
+        return (av->fill.f > bv->fill.f) - (av->fill.f < bv->fill.f);
+}
+void chrom_sort_bins(chrom_t *chrom, const sizes_t *sizes) {
+        /* only the bin descriptors move, the items stay where they are */
+        qsort(chrom->bins, chrom->num_bins, sizeof(*chrom->bins),
+              (sizes->kind == SIZE_FLOAT) ? bin_cmp_float : bin_cmp_int);
 }
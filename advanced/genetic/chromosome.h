@@ -1,32 +1,111 @@
 #ifndef CHROMOSOME_H
 #define CHROMOSOME_H
 
+#include "arena.h"
+#include "item-set.h"
+#include "rng.h"
+#include "sizes.h"
 #include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
 
+#define BIN_SIG_WORDS   4
+
+/* a bin is a range of chrom->items: [start, start + count) */
 typedef struct bin bin_t;
 struct bin {
-        long double fill;
+        fill_t fill;
+        size_t start;
         size_t count;
-        size_t *item_indices;
+        /* hashed set of the bin's items: bins whose signatures do not
+         * intersect share no items */
+        uint64_t sig[BIN_SIG_WORDS];
+};
+
+/* item indices are stored in the narrowest type that holds them all */
+typedef enum index_kind index_kind_t;
+enum index_kind {
+        INDEX_U16,
+        INDEX_U32
 };
 
 typedef struct chromosome chrom_t;
 struct chromosome {
+        /* fill_sum / num_bins, where fill_sum is the sum over the bins of
+         * (fill / cap)^fitness_k, kept up to date as bins are filled, added and
+         * deleted */
         double fitness;
-        long double bin_cap;
+        double fill_sum;
+        size_t num_items;
         size_t num_bins;
-        bin_t **bins;
+        index_kind_t index_kind;
+        /* both have room for num_items entries since no bin is empty */
+        bin_t *bins;
+        union {
+                void *items;
+                uint16_t *u16;
+                uint32_t *u32;
+        };
+};
+
+/** Returns the item at position pos of chrom->items */
+static inline size_t chrom_item(const chrom_t *chrom, size_t pos) {
+        if (chrom->index_kind == INDEX_U16) {
+                return chrom->u16[pos];
+        }
+        return chrom->u32[pos];
+}
+
+/* How crossover and mutation reinsert the items their bins lost: first-
+ * or best-fit, in index order or by decreasing size */
+typedef enum repair repair_t;
+enum repair {
+        REPAIR_FF,
+        REPAIR_FFD,
+        REPAIR_BF,
+        REPAIR_BFD
+};
+
+/* Per-thread scratch space of the operators below: an arena each operator
+ * rewinds before returning, and a set of used items that is cleared in
+ * O(1). On large problems crossover tracks the used items in the bitset
+ * instead, which is a 32nd of the size. A workspace serves one thread and
+ * problems of up to num_items items, scored with the exponent
+ * fitness_k and repaired with the given strategy, after dominance swaps
+ * if dominance is set. The operators draw from the workspace's
+ * generator, which chrom_ws_new() seeds with seed. */
+typedef struct chrom_ws chrom_ws_t;
+struct chrom_ws {
+        arena_t *arena;
+        rng_t rng;
+        unsigned fitness_k;
+        repair_t repair;
+        bool dominance;
+        item_set_t used;
+        bool use_bitset;
+        bool have_avx2;
+        bool have_avx512;
+        uint64_t *used_bits;
 };
 
-chrom_t *rand_first_fit(const long double *item_sizes, size_t num_items,
-                        long double bin_cap);
-void chrom_free(chrom_t *chrom);
+chrom_ws_t *chrom_ws_new(size_t num_items, unsigned fitness_k,
+                         repair_t repair, bool dominance, uint64_t seed);
+void chrom_ws_free(chrom_ws_t *ws);
+
+/* Chromosomes are allocated once, from and freed with the given arena,
+ * and then overwritten in place by the operators below. */
+chrom_t *chrom_alloc(arena_t *arena, size_t num_items);
+
+void rand_first_fit(chrom_ws_t *ws, chrom_t *chrom, const sizes_t *sizes);
 
-chrom_t *chrom_copy(const chrom_t *chrom);
+void chrom_copy(chrom_t *dst, const chrom_t *src);
 
-chrom_t *chrom_cx(const chrom_t *parent1, const chrom_t *parent2,
-                  const long double *item_sizes, size_t num_items);
-void chrom_mutate(chrom_t *chrom, double mutation_rate,
-                  const long double *item_sizes, size_t num_items);
+void chrom_cx(chrom_ws_t *ws, chrom_t *child,
+              const chrom_t *parent1, const chrom_t *parent2,
+              const sizes_t *sizes);
+void chrom_mutate(chrom_ws_t *ws, chrom_t *chrom, double mutation_rate,
+                  const sizes_t *sizes);
+/* the inversion operator: orders the bins by increasing fill */
+void chrom_sort_bins(chrom_t *chrom, const sizes_t *sizes);
 
 #endif /* !CHROMOSOME_H */
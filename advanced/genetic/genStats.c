@@ -9,20 +9,13 @@
 #include<math.h>
 
 #define POP_SZ 50
+#define ARENA_BLOCK_SZ (1 << 20)
 
 static const char *basename_of(const char *path) {
     const char *p = strrchr(path, '/');
     return p ? p + 1 : path;
 }
 
-static int bin_cmp(const void *a, const void *b) {
-    const bin_t *av = *(bin_t **)a;
-    const bin_t *bv = *(bin_t **)b;
-    if (av->fill < bv->fill) return -1;
-    if (av->fill > bv->fill) return 1;
-    return 0;
-}
-
 int main(int argc, char **argv) {
     if (argc != 2) {
         fprintf(stderr, "Usage: %s <input-file>\n", argv[0]);
@@ -42,7 +35,7 @@ int main(int argc, char **argv) {
         return 4;
     }
 
-    srand((unsigned)time(NULL));
+    uint64_t seed = time(NULL);
 
     for (size_t p = 0; p < num_problems; p++) {
         char prob_id[256];
@@ -84,13 +77,21 @@ int main(int argc, char **argv) {
         double max_mutation_rate = 0.1;
         double tournament_p = 1.0;
         unsigned tournament_size = 2;
+        unsigned fitness_k = 2;
         bool use_inversion = true;
         double max_secs = 1.0;
 
         clock_t start = clock();
 
         /* initialize population */
-        pop_t *pop = pop_rand_init(bin_capacity, population_size, item_sizes, num_items);
+        /* two population buffers that swap roles every generation */
+        arena_t *arena = arena_new(ARENA_BLOCK_SZ);
+        chrom_ws_t *ws = chrom_ws_new(num_items, fitness_k, REPAIR_FF, false,
+                                      seed + p);
+        const sizes_t *sizes = sizes_new(arena, item_sizes, num_items, bin_capacity);
+        pop_t *pop = pop_rand_init(arena, ws, population_size, sizes);
+        pop_t *child = pop_alloc_chroms(arena, population_size, num_items);
+        pop_t *mp = pop_alloc(arena, mating_pool_size);
 
         const chrom_t *best = pop->chroms[0];
         for (size_t i = 1; i < pop->num_chroms; i++) {
@@ -112,33 +113,30 @@ int main(int argc, char **argv) {
             }
 
             /* tournament selection */
-            pop_t *mp = pop_alloc(mating_pool_size);
             for (size_t i = 0; i < mating_pool_size; i++) {
-                mp->chroms[i] = pop->chroms[rand() % pop->num_chroms];
+                mp->chroms[i] = pop->chroms[rng_below(&ws->rng, pop->num_chroms)];
                 for (unsigned j = 1; j < tournament_size; j++) {
-                    size_t k = rand() % pop->num_chroms;
+                    size_t k = rng_below(&ws->rng, pop->num_chroms);
                     if (mp->chroms[i]->fitness < pop->chroms[k]->fitness) mp->chroms[i] = pop->chroms[k];
                 }
             }
 
             /* child population */
-            pop_t *child = pop_alloc(population_size);
-            child->chroms[0] = chrom_copy(best);
+            chrom_copy(child->chroms[0], best);
             for (size_t i = 1; i < child->num_chroms; i++) {
-                size_t i1 = rand() % mp->num_chroms;
-                size_t i2 = rand() % mp->num_chroms;
-                child->chroms[i] = chrom_cx(mp->chroms[i1], mp->chroms[i2], item_sizes, num_items);
+                size_t i1 = rng_below(&ws->rng, mp->num_chroms);
+                size_t i2 = rng_below(&ws->rng, mp->num_chroms);
+                chrom_cx(ws, child->chroms[i], mp->chroms[i1], mp->chroms[i2], sizes);
             }
-            free(mp);
 
             if (use_inversion) {
                 for (size_t i = 1; i < child->num_chroms; i++) {
-                    qsort(child->chroms[i]->bins, child->chroms[i]->num_bins, sizeof(*child->chroms[i]->bins), bin_cmp);
+                    chrom_sort_bins(child->chroms[i], sizes);
                 }
             }
 
             for (size_t i = 1; i < child->num_chroms; i++) {
-                chrom_mutate(child->chroms[i], max_mutation_rate, item_sizes, num_items);
+                chrom_mutate(ws, child->chroms[i], max_mutation_rate, sizes);
             }
 
             /* find new best */
@@ -154,12 +152,14 @@ int main(int argc, char **argv) {
             avg /= (double)child->num_chroms;
             fprintf(out, "%zu,%lf,%zu,%lf,%lf\n", gen + 1, avg, new_best->num_bins, new_best->fitness, endsec);
 
-            pop_free(pop);
+            pop_t *tmp = pop;
             pop = child;
+            child = tmp;
             best = new_best;
         }
 
-        pop_free(pop);
+        arena_free(arena);
+        chrom_ws_free(ws);
         fclose(out);
         free(outname);
         free(item_sizes);
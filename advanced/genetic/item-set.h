@@ -0,0 +1,44 @@
+#ifndef ITEM_SET_H
+#define ITEM_SET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* Set of item indices in [0, size) that is emptied in O(1): an item is in
+ * the set when its stamp equals the current epoch, so clearing only moves
+ * on to the next epoch. The stamps are zeroed again when the epoch wraps
+ * around. */
+typedef struct item_set item_set_t;
+struct item_set {
+        uint32_t epoch;
+        size_t size;
+        uint32_t *stamps;
+};
+
+/** stamps must hold size zeroed entries and outlive the set */
+static inline void item_set_init(item_set_t *set, uint32_t *stamps,
+                                 size_t size) {
+        *set = (item_set_t){.epoch = 1,
+                            .size = size,
+                            .stamps = stamps};
+}
+static inline void item_set_clear(item_set_t *set) {
+        set->epoch++;
+        if (set->epoch == 0) {
+                memset(set->stamps, 0, set->size * sizeof(*set->stamps));
+                set->epoch = 1;
+        }
+}
+static inline bool item_set_has(const item_set_t *set, size_t item) {
+        return set->stamps[item] == set->epoch;
+}
+static inline void item_set_add(item_set_t *set, size_t item) {
+        set->stamps[item] = set->epoch;
+}
+static inline void item_set_del(item_set_t *set, size_t item) {
+        set->stamps[item] = 0;
+}
+
+#endif /* !ITEM_SET_H */
@@ -0,0 +1,65 @@
+#include "mailbox.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#define NUM_ITEMS       64
+#define BIN_CAP         100
+#define NUM_POSTS       100000
+#define SEED            3
+
+static mailbox_t mb;
+static arena_t *arena;
+static const sizes_t *sizes;
+
+/* posts chromosomes whose fitness counts up from 1 */
+static void *sender(void *arg) {
+        chrom_ws_t *ws = chrom_ws_new(NUM_ITEMS, 2, REPAIR_FF, false, SEED);
+        chrom_t *chrom = arg;
+        for (size_t i=1; i<=NUM_POSTS; i++) {
+                rand_first_fit(ws, chrom, sizes);
+                chrom->fitness = i;
+                mailbox_post(&mb, chrom);
+        }
+        chrom_ws_free(ws);
+        return NULL;
+}
+
+int main(void) {
+        arena = arena_new(1 << 16);
+        long double item_sizes[NUM_ITEMS];
+        srand(SEED);
+        for (size_t i=0; i<NUM_ITEMS; i++) {
+                item_sizes[i] = rand() % (BIN_CAP / 2) + 1;
+        }
+        sizes = sizes_new(arena, item_sizes, NUM_ITEMS, BIN_CAP);
+        mailbox_init(&mb, arena, NUM_ITEMS);
+        printf("empty take: %d\n", mailbox_take(&mb) == NULL);
+        chrom_t *chrom = chrom_alloc(arena, NUM_ITEMS);
+        pthread_t thread;
+        pthread_create(&thread, NULL, sender, chrom);
+        size_t taken = 0, out_of_order = 0, bad_bins = 0;
+        double last = 0;
+        while (last < NUM_POSTS) {
+                const chrom_t *c = mailbox_take(&mb);
+                if (c == NULL) {
+                        continue;
+                }
+                taken++;
+                out_of_order += (c->fitness <= last);
+                last = c->fitness;
+                /* a torn copy would not hold every item once */
+                size_t count = 0;
+                for (size_t b=0; b<c->num_bins; b++) {
+                        count += c->bins[b].count;
+                }
+                bad_bins += (count != NUM_ITEMS);
+        }
+        pthread_join(thread, NULL);
+        printf("took some: %d\n", taken > 0);
+        printf("out of order: %zu\n", out_of_order);
+        printf("torn copies: %zu\n", bad_bins);
+        printf("taken twice: %d\n", mailbox_take(&mb) != NULL);
+        arena_free(arena);
+        return 0;
+}
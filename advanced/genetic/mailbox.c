@@ -0,0 +1,38 @@
+#include "mailbox.h"
+
+#define MAILBOX_FRESH   4u
+
+void mailbox_init(mailbox_t *mb, arena_t *arena, size_t num_items) {
+        for (int i=0; i<3; i++) {
+                mb->bufs[i] = chrom_alloc(arena, num_items);
+        }
+        atomic_flag_clear(&mb->posting);
+        mb->back = 0;
+        atomic_init(&mb->middle, 1);
+        mb->front = 2;
+}
+bool mailbox_post(mailbox_t *mb, const chrom_t *chrom) {
+        if (atomic_flag_test_and_set_explicit(&mb->posting,
+                                              memory_order_acquire)) {
+                return false;
+        }
+        chrom_copy(mb->bufs[mb->back], chrom);
+        /* release the copy to the reader, and acquire the buffer it
+         * gave back */
+        mb->back = atomic_exchange_explicit(&mb->middle,
+                                            mb->back | MAILBOX_FRESH,
+                                            memory_order_acq_rel)
+                   & ~MAILBOX_FRESH;
+        atomic_flag_clear_explicit(&mb->posting, memory_order_release);
+        return true;
+}
+const chrom_t *mailbox_take(mailbox_t *mb) {
+        if (!(atomic_load_explicit(&mb->middle, memory_order_relaxed)
+              & MAILBOX_FRESH)) {
+                return NULL;
+        }
+        mb->front = atomic_exchange_explicit(&mb->middle, mb->front,
+                                             memory_order_acq_rel)
+                    & ~MAILBOX_FRESH;
+        return mb->bufs[mb->front];
+}
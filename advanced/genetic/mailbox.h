@@ -0,0 +1,37 @@
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include "chromosome.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+
+/* Lock-free mailbox holding the latest chromosome posted to its reader.
+ * It is a triple buffer: the sender fills the back buffer and swaps it
+ * with the middle one, the reader swaps the middle one with its front
+ * buffer when it is fresh, and neither ever waits for the other. Senders
+ * may be many, but only one fills the back buffer at a time; a post that
+ * finds another under way is dropped rather than waiting. There is one
+ * reader. */
+typedef struct mailbox mailbox_t;
+struct mailbox {
+        chrom_t *bufs[3];
+        /* held by the sender filling bufs[back] */
+        atomic_flag posting;
+        unsigned back;
+        /* index of the middle buffer, with MAILBOX_FRESH set if it holds a
+         * chromosome the reader has not taken */
+        atomic_uint middle;
+        unsigned front;
+};
+
+/** Initializes mb with buffers for chromosomes of num_items items, from
+ * arena */
+void mailbox_init(mailbox_t *mb, arena_t *arena, size_t num_items);
+/** Posts a copy of chrom to mb; returns false if it was dropped because
+ * another sender was posting */
+bool mailbox_post(mailbox_t *mb, const chrom_t *chrom);
+/** Returns the chromosome last posted to mb if the reader has not taken
+ * it yet, else NULL. It stays valid until the next call. */
+const chrom_t *mailbox_take(mailbox_t *mb);
+
+#endif /* !MAILBOX_H */
@@ -1,73 +1,254 @@
 #include "bin-packing.h"
+#include "pool.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 #include <string.h>
+#include <pthread.h>
 
 #define NUM_PASSES      25
 #define POP_SZ          50
+#define FITNESS_K       2
+/* generations between migrations when there are islands */
+#define MIGRATION_INTERVAL 10
 
 static int results_only = 0;
+static repair_t repair = REPAIR_FF;
+static bool use_dominance = false;
+static uint64_t seed;
+static size_t num_workers = 1;
+static size_t num_islands = 1;
+static migration_t migration = MIGRATE_RING;
+/* passes run at once */
+static size_t num_jobs = 1;
+/* passes of a problem share a board, and maybe adopt its incumbent */
+static bool share_board = false;
+static bool adopt_incumbent = false;
+static bool steady_state = false;
 
 static void falk_main(void);
 
+/** Parses a positive count from arg into *count; returns false if it is
+ * not one */
+static bool parse_count(const char *arg, size_t *count) {
+        char *end;
+        *count = strtoul(arg, &end, 10);
+        return (*arg != '\0') && (*end == '\0') && (*count > 0);
+}
+
 int main(int argc, char **argv) {
+        seed = time(NULL);
         for (int i = 1; i < argc; i++) {
                 if ((strcmp(argv[i], "-results") == 0)
                     || (strcmp(argv[i], "--results") == 0)) {
                         results_only = 1;
+                } else if (strcmp(argv[i], "--dominance") == 0) {
+                        use_dominance = true;
+                } else if (strcmp(argv[i], "--steady") == 0) {
+                        steady_state = true;
+                } else if (strcmp(argv[i], "--share") == 0) {
+                        share_board = true;
+                } else if (strcmp(argv[i], "--adopt") == 0) {
+                        share_board = true;
+                        adopt_incumbent = true;
+                } else if ((strcmp(argv[i], "--repair") == 0)
+                           && (i + 1 < argc)) {
+                        const char *names[] = {
+                                [REPAIR_FF] = "ff", [REPAIR_FFD] = "ffd",
+                                [REPAIR_BF] = "bf", [REPAIR_BFD] = "bfd"};
+                        i++;
+                        size_t r = 0;
+                        while ((r < sizeof(names) / sizeof(*names))
+                               && (strcmp(argv[i], names[r]) != 0)) {
+                                r++;
+                        }
+                        if (r == sizeof(names) / sizeof(*names)) {
+                                fprintf(stderr, "unknown repair: %s\n",
+                                        argv[i]);
+                                return 1;
+                        }
+                        repair = r;
+                } else if ((strcmp(argv[i], "--threads") == 0)
+                           && (i + 1 < argc)) {
+                        if (!parse_count(argv[++i], &num_workers)) {
+                                fprintf(stderr, "bad thread count: %s\n",
+                                        argv[i]);
+                                return 1;
+                        }
+                } else if ((strcmp(argv[i], "--islands") == 0)
+                           && (i + 1 < argc)) {
+                        if (!parse_count(argv[++i], &num_islands)) {
+                                fprintf(stderr, "bad island count: %s\n",
+                                        argv[i]);
+                                return 1;
+                        }
+                } else if ((strcmp(argv[i], "--jobs") == 0)
+                           && (i + 1 < argc)) {
+                        if (!parse_count(argv[++i], &num_jobs)) {
+                                fprintf(stderr, "bad job count: %s\n",
+                                        argv[i]);
+                                return 1;
+                        }
+                } else if ((strcmp(argv[i], "--migration") == 0)
+                           && (i + 1 < argc)) {
+                        i++;
+                        if (strcmp(argv[i], "ring") == 0) {
+                                migration = MIGRATE_RING;
+                        } else if (strcmp(argv[i], "random") == 0) {
+                                migration = MIGRATE_RANDOM;
+                        } else {
+                                fprintf(stderr, "unknown migration: %s\n",
+                                        argv[i]);
+                                return 1;
+                        }
+                } else if ((strcmp(argv[i], "--seed") == 0)
+                           && (i + 1 < argc)) {
+                        char *end;
+                        seed = strtoull(argv[++i], &end, 0);
+                        if ((*argv[i] == '\0') || (*end != '\0')) {
+                                fprintf(stderr, "bad seed: %s\n", argv[i]);
+                                return 1;
+                        }
                 }
         }
 
-        srand(time(NULL));
+        /* so that a run can be repeated with --seed */
+        fprintf(stderr, "SEED: %llu\n", (unsigned long long)seed);
         falk_main();
         return 0;
 }
 
-static void falk_main_solve(void) {
+typedef struct problem problem_t;
+struct problem {
+        long double bin_capacity;
+        size_t num_items;
+        size_t optimal_num_bins;
+        long double *item_sizes;
+        /* shared by its passes with --share, else NULL */
+        board_t *board;
+};
+/* A task is one pass on one problem, task t being pass t % NUM_PASSES of
+ * problem t / NUM_PASSES. Its output is kept until every task before it
+ * has been printed, so the output does not depend on how the tasks ran. */
+typedef struct task task_t;
+struct task {
+        char *out;
+        size_t out_len;
+        bool done;
+};
+typedef struct batch batch_t;
+struct batch {
+        const problem_t *problems;
+        task_t *tasks;
+        /* guards done of the tasks */
+        pthread_mutex_t lock;
+        pthread_cond_t done;
+};
+
+static void read_problem(problem_t *prob) {
         /* skip problem identifier */
         scanf(" %*s");
-        long double bin_capacity;
-        size_t num_items, optimal_num_bins;
         scanf(" %Lf %zu %zu",
-              &bin_capacity, &num_items, &optimal_num_bins);
-        long double *item_sizes = malloc(num_items
-                                       * sizeof(*item_sizes));
-        for (size_t i=0; i<num_items; i++) {
-                scanf(" %Lf", item_sizes+i);
+              &prob->bin_capacity, &prob->num_items,
+              &prob->optimal_num_bins);
+        prob->item_sizes = malloc(prob->num_items
+                                  * sizeof(*prob->item_sizes));
+        for (size_t i=0; i<prob->num_items; i++) {
+                scanf(" %Lf", prob->item_sizes+i);
+        }
+        prob->board = NULL;
+        if (share_board) {
+                prob->board = board_new(prob->item_sizes, prob->num_items,
+                                        prob->bin_capacity);
         }
-        prob_set_t ps = {.item_sizes = item_sizes,
-                         .num_items = num_items,
-                         .bin_capacity = bin_capacity,
+}
+static void run_pass(void *arg, size_t t) {
+        batch_t *batch = arg;
+        const problem_t *prob = &batch->problems[t / NUM_PASSES];
+        task_t *task = &batch->tasks[t];
+        FILE *out = open_memstream(&task->out, &task->out_len);
+        fprintf(out, "PASS #%zu:\n", t % NUM_PASSES);
+        prob_set_t ps = {.item_sizes = prob->item_sizes,
+                         .num_items = prob->num_items,
+                         .bin_capacity = prob->bin_capacity,
                          .max_generations = 1000000,
-                         .terminal_num_bins = optimal_num_bins,
+                         .terminal_num_bins = prob->optimal_num_bins,
                          .max_secs = 1,
                          .population_size = POP_SZ,
                          .mating_pool_size = POP_SZ,
                          .max_mutation_rate = 0.1,
                          .tournament_p = 1.0,
                          .tournament_size = 2,
+                         .fitness_k = FITNESS_K,
+                         .repair = repair,
+                         .use_dominance = use_dominance,
+                         /* a fresh stream per pass, and per problem as
+                          * the task advances across them */
+                         .seed = seed + t,
+                         .num_workers = num_workers,
+                         .num_islands = num_islands,
+                         .migration_interval = MIGRATION_INTERVAL,
+                         .migration = migration,
+                         .board = prob->board,
+                         .adopt_incumbent = adopt_incumbent,
+                         .steady_state = steady_state,
                          .use_inversion_operator = true,
-                         .results_only = results_only};
-        printf("OPTIMAL NUMBER OF BINS: %zu\n", optimal_num_bins);
-        for (size_t i=0; i<NUM_PASSES; i++) {
-                printf("PASS #%zu:\n", i);
-                fprintf(stderr, "PASS #%zu:\n", i);
-                result_t *res = bin_packing(&ps);
-                if (results_only) {
-                        printf("FINAL: #bins: %zu\t fitness: %lf\n",
-                               res->num_bins, res->fitness);
-                }
-                result_free(res);
+                         .results_only = results_only,
+                         .out = out};
+        result_t *res = bin_packing(&ps);
+        if (results_only) {
+                fprintf(out, "FINAL: #bins: %zu\t fitness: %lf\n",
+                        res->num_bins, res->fitness);
         }
-        free(item_sizes);
+        result_free(res);
+        fclose(out);
+        pthread_mutex_lock(&batch->lock);
+        task->done = true;
+        pthread_cond_broadcast(&batch->done);
+        pthread_mutex_unlock(&batch->lock);
 }
 static void falk_main(void) {
         size_t num_problems;
         scanf(" %zu", &num_problems);
+        problem_t *problems = malloc(num_problems * sizeof(*problems));
         for (size_t i=0; i<num_problems; i++) {
-                printf("PROBLEM #%zu:\n", i);
-                fprintf(stderr, "PROBLEM #%zu:\n", i);
-                falk_main_solve();
+                read_problem(&problems[i]);
+        }
+        size_t num_tasks = num_problems * NUM_PASSES;
+        batch_t batch = {.problems = problems,
+                         .tasks = calloc(num_tasks, sizeof(*batch.tasks))};
+        pthread_mutex_init(&batch.lock, NULL);
+        pthread_cond_init(&batch.done, NULL);
+        pool_t *pool = pool_start(num_jobs, num_tasks, run_pass, &batch);
+        /* print every task as soon as it and all before it are done */
+        for (size_t t=0; t<num_tasks; t++) {
+                size_t i = t / NUM_PASSES;
+                if (t % NUM_PASSES == 0) {
+                        printf("PROBLEM #%zu:\n", i);
+                        fprintf(stderr, "PROBLEM #%zu:\n", i);
+                        printf("OPTIMAL NUMBER OF BINS: %zu\n",
+                               problems[i].optimal_num_bins);
+                }
+                task_t *task = &batch.tasks[t];
+                pthread_mutex_lock(&batch.lock);
+                while (!task->done) {
+                        pthread_cond_wait(&batch.done, &batch.lock);
+                }
+                pthread_mutex_unlock(&batch.lock);
+                fprintf(stderr, "PASS #%zu:\n", t % NUM_PASSES);
+                fwrite(task->out, 1, task->out_len, stdout);
+                fflush(stdout);
+                free(task->out);
+        }
+        pool_join(pool);
+        pthread_cond_destroy(&batch.done);
+        pthread_mutex_destroy(&batch.lock);
+        free(batch.tasks);
+        for (size_t i=0; i<num_problems; i++) {
+                if (problems[i].board != NULL) {
+                        board_free(problems[i].board);
+                }
+                free(problems[i].item_sizes);
         }
+        free(problems);
 }
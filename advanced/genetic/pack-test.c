@@ -0,0 +1,164 @@
+#include "pack.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BIN_CAP         1000
+/* past which the bins are kept in a B-tree rather than buckets */
+#define LARGE_CAP       (1000 * 1000)
+#define NUM_ITEMS       5000
+#define NUM_LARGE       10000000
+#define NUM_CASES       4
+#define NUM_RULES       5
+
+static const char *rule_names[NUM_RULES] = {
+        [PACK_FF] = "ff", [PACK_FFD] = "ffd", [PACK_BF] = "bf",
+        [PACK_BFD] = "bfd", [PACK_WF] = "wf"};
+
+/* the rules the plain way, as run_ff() and run_bf() in heuristics/ */
+static size_t ref_pack(pack_rule_t rule, const uint32_t *sizes,
+                       const uint32_t *order, size_t num_items, uint32_t cap,
+                       uint32_t *res, uint32_t *assign) {
+        size_t num_bins = 0;
+        for (size_t k=0; k<num_items; k++) {
+                uint32_t item = order[k];
+                size_t pick = num_bins;
+                for (size_t b=0; b<num_bins; b++) {
+                        if (res[b] < sizes[item]) {
+                                continue;
+                        }
+                        if ((pick == num_bins)
+                            || ((rule == PACK_WF) && (res[b] > res[pick]))
+                            || ((rule == PACK_BF) && (res[b] < res[pick]))) {
+                                pick = b;
+                        }
+                        if (rule == PACK_FF) {
+                                break;
+                        }
+                }
+                if (pick == num_bins) {
+                        res[num_bins++] = cap;
+                }
+                res[pick] -= sizes[item];
+                assign[item] = pick;
+        }
+        return num_bins;
+}
+static const uint32_t *cmp_sizes;
+/* decreasing size, then index, as Python's stable sorted(reverse=True) */
+static int decreasing_cmp(const void *a, const void *b) {
+        uint32_t i = *(const uint32_t *)a, j = *(const uint32_t *)b;
+        if (cmp_sizes[i] != cmp_sizes[j]) {
+                return (cmp_sizes[i] > cmp_sizes[j]) ? -1 : 1;
+        }
+        return (i > j) - (i < j);
+}
+static bool same(const uint32_t *a, const uint32_t *b, size_t n) {
+        for (size_t i=0; i<n; i++) {
+                if (a[i] != b[i]) {
+                        return false;
+                }
+        }
+        return true;
+}
+/** Returns true if pack() puts every item where ref_pack() does */
+static bool as_plain(pack_rule_t rule, const uint32_t *sizes,
+                     uint32_t cap) {
+        static uint32_t order[NUM_ITEMS], res[NUM_ITEMS];
+        static uint32_t expected[NUM_ITEMS], assign[NUM_ITEMS];
+        for (size_t i=0; i<NUM_ITEMS; i++) {
+                order[i] = i;
+        }
+        pack_rule_t plain = rule;
+        if ((rule == PACK_FFD) || (rule == PACK_BFD)) {
+                cmp_sizes = sizes;
+                qsort(order, NUM_ITEMS, sizeof(*order), decreasing_cmp);
+                plain = (rule == PACK_FFD) ? PACK_FF : PACK_BF;
+        }
+        size_t ref_bins = ref_pack(plain, sizes, order, NUM_ITEMS, cap, res,
+                                   expected);
+        size_t bins = pack(rule, sizes, NUM_ITEMS, cap, assign);
+        return (bins == ref_bins) && same(assign, expected, NUM_ITEMS);
+}
+/** Returns true if no bin of assign overflows and all are used */
+static bool valid(const uint32_t *sizes, size_t num_items, size_t num_bins,
+                  const uint32_t *assign) {
+        uint64_t *fill = calloc(num_bins, sizeof(*fill));
+        bool ok = true;
+        for (size_t i=0; i<num_items; i++) {
+                ok = ok && (assign[i] < num_bins);
+                if (ok) {
+                        fill[assign[i]] += sizes[i];
+                }
+        }
+        for (size_t b=0; ok && (b<num_bins); b++) {
+                ok = (fill[b] > 0) && (fill[b] <= BIN_CAP);
+        }
+        free(fill);
+        return ok;
+}
+
+int main(void) {
+        uint32_t small[] = {400, 800, 100, 400, 200, 100};
+        size_t num_small = sizeof(small) / sizeof(*small);
+        uint32_t assign[NUM_ITEMS];
+        for (pack_rule_t r=0; r<NUM_RULES; r++) {
+                size_t bins = pack(r, small, num_small, BIN_CAP, assign);
+                printf("%s: %zu bins:", rule_names[r], bins);
+                for (size_t i=0; i<num_small; i++) {
+                        printf(" %u", assign[i]);
+                }
+                printf("\n");
+        }
+
+        /* items up to max_size, so that ties and full bins both occur */
+        static const uint32_t max_size[NUM_CASES] = {10, 300, 700,
+                                                     BIN_CAP};
+        static uint32_t sizes[NUM_ITEMS];
+        srand(3);
+        for (size_t c=0; c<NUM_CASES; c++) {
+                for (size_t i=0; i<NUM_ITEMS; i++) {
+                        sizes[i] = rand() % max_size[c] + 1;
+                }
+                printf("sizes up to %u as plain:", max_size[c]);
+                for (pack_rule_t r=0; r<NUM_RULES; r++) {
+                        printf(" %s %d", rule_names[r],
+                               as_plain(r, sizes, BIN_CAP));
+                }
+                /* the same, scaled past the buckets */
+                for (size_t i=0; i<NUM_ITEMS; i++) {
+                        sizes[i] *= LARGE_CAP / BIN_CAP;
+                }
+                printf(", B-tree:");
+                for (pack_rule_t r=0; r<NUM_RULES; r++) {
+                        printf(" %s %d", rule_names[r],
+                               as_plain(r, sizes, LARGE_CAP));
+                }
+                printf("\n");
+        }
+
+        uint32_t *large = malloc(NUM_LARGE * sizeof(*large));
+        uint32_t *large_assign = malloc(NUM_LARGE * sizeof(*large_assign));
+        for (size_t i=0; i<NUM_LARGE; i++) {
+                large[i] = rand() % BIN_CAP + 1;
+        }
+        size_t ff_bins = 0;
+        for (pack_rule_t r=0; r<NUM_RULES; r++) {
+                size_t bins = pack(r, large, NUM_LARGE, BIN_CAP,
+                                   large_assign);
+                if (r == PACK_FF) {
+                        ff_bins = bins;
+                }
+                printf("%s of %d items valid: %d", rule_names[r], NUM_LARGE,
+                       valid(large, NUM_LARGE, bins, large_assign));
+                if ((r == PACK_FFD) || (r == PACK_BFD)) {
+                        printf(", no more bins than ff: %d",
+                               bins <= ff_bins);
+                }
+                printf("\n");
+        }
+        free(large);
+        free(large_assign);
+        return 0;
+}
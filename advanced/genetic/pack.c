@@ -0,0 +1,622 @@
+#include "pack.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+
+/* leaves of a new residual tree; it doubles whenever they are all open */
+#define RES_TREE_LEAVES         64
+#define RADIX_BITS              8
+#define RADIX                   (1 << RADIX_BITS)
+#define RADIX_PASSES            (32 / RADIX_BITS)
+
+/* First-fit runs on a tree of the bin residuals (cf. the segment tree of
+ * heuristics/firstfit/ff.py): node 1 is the root, the children of node j
+ * are 2j and 2j + 1, and leaf i, at leaves + i, holds the residual of bin
+ * i. Every other node holds the largest residual below it, so the first
+ * bin with room for an item is found by one walk down from the root. The
+ * leaves past the open bins hold the full capacity and stand for the bins
+ * still to be opened, so a walk always ends on a bin, possibly a new
+ * one; there is always one such leaf, as the tree doubles when the last
+ * is opened, and with it the rebuild of ff.py is only paid O(log n)
+ * times. */
+typedef struct res_tree res_tree_t;
+struct res_tree {
+        size_t leaves;
+        uint32_t *node;
+        uint32_t cap;
+};
+
+static inline uint32_t max_u32(uint32_t a, uint32_t b) {
+        return (a > b) ? a : b;
+}
+static void res_tree_build(res_tree_t *t) {
+        for (size_t j=t->leaves-1; j>0; j--) {
+                t->node[j] = max_u32(t->node[2*j], t->node[2*j + 1]);
+        }
+}
+static void res_tree_init(res_tree_t *t, uint32_t cap) {
+        t->leaves = RES_TREE_LEAVES;
+        t->cap = cap;
+        t->node = malloc(2 * t->leaves * sizeof(*t->node));
+        for (size_t i=0; i<t->leaves; i++) {
+                t->node[t->leaves + i] = cap;
+        }
+        res_tree_build(t);
+}
+static void res_tree_grow(res_tree_t *t) {
+        size_t leaves = 2 * t->leaves;
+        uint32_t *node = malloc(2 * leaves * sizeof(*node));
+        memcpy(node + leaves, t->node + t->leaves,
+               t->leaves * sizeof(*node));
+        for (size_t i=t->leaves; i<leaves; i++) {
+                node[leaves + i] = t->cap;
+        }
+        free(t->node);
+        t->node = node;
+        t->leaves = leaves;
+        res_tree_build(t);
+}
+/** Puts an item of the given size in the first bin with room for it,
+ * opening a new one if there is none; returns the bin */
+static inline uint32_t res_tree_first_fit(res_tree_t *t, size_t *num_bins,
+                                          uint32_t size) {
+        if (*num_bins == t->leaves) {
+                res_tree_grow(t);
+        }
+        uint32_t *node = t->node;
+        size_t j = 1;
+        while (j < t->leaves) {
+                /* go right only if no bin on the left has room */
+                j = 2*j + (node[2*j] < size);
+        }
+        size_t bin = j - t->leaves;
+        if (bin == *num_bins) {
+                (*num_bins)++;
+        }
+        /* only go up while the largest residual below changes */
+        for (node[j] -= size, j /= 2; j > 0; j /= 2) {
+                uint32_t top = max_u32(node[2*j], node[2*j + 1]);
+                if (node[j] == top) {
+                        break;
+                }
+                node[j] = top;
+        }
+        return bin;
+}
+
+/** Returns the items sorted by decreasing size, equal ones in index
+ * order, each as its inverted size over its index. The sort is an LSD
+ * radix sort on the upper half, which is stable and skips the digits
+ * that all sizes share. */
+static uint64_t *sort_decreasing(const uint32_t *sizes, size_t num_items) {
+        uint64_t *keyed = malloc(num_items * sizeof(*keyed));
+        uint64_t *tmp = malloc(num_items * sizeof(*tmp));
+        size_t (*count)[RADIX] = calloc(RADIX_PASSES, sizeof(*count));
+        for (size_t i=0; i<num_items; i++) {
+                uint32_t key = ~sizes[i];
+                keyed[i] = ((uint64_t)key << 32) | i;
+                for (unsigned d=0; d<RADIX_PASSES; d++) {
+                        count[d][(key >> (d * RADIX_BITS)) & (RADIX - 1)]++;
+                }
+        }
+        for (unsigned d=0; d<RADIX_PASSES; d++) {
+                unsigned shift = 32 + (d * RADIX_BITS);
+                if (count[d][(keyed[0] >> shift) & (RADIX - 1)]
+                    == num_items) {
+                        continue;
+                }
+                size_t offset[RADIX];
+                for (size_t b=0, sum=0; b<RADIX; b++) {
+                        offset[b] = sum;
+                        sum += count[d][b];
+                }
+                for (size_t i=0; i<num_items; i++) {
+                        tmp[offset[(keyed[i] >> shift) & (RADIX - 1)]++]
+                                = keyed[i];
+                }
+                uint64_t *swap = keyed;
+                keyed = tmp;
+                tmp = swap;
+        }
+        free(count);
+        free(tmp);
+        return keyed;
+}
+
+/* Best-fit and worst-fit keep the open bins ordered by residual, and bins
+ * of equal residual by index, the order in which run_bf() in
+ * heuristics/bestfit/bf.py prefers them. Small capacities index the
+ * residuals directly: a bucket per residual holds a heap of its bins,
+ * and three levels of 64-bit words, as in a van Emde Boas tree of fanout
+ * 64, mark the buckets that are not empty, so the next residual up from
+ * any value and the largest are found with a few bit scans. Larger
+ * capacities keep the bins in a B-tree instead. */
+#define BUCKET_LEVEL_BITS       6
+#define BUCKET_MAX_CAP          ((UINT32_C(1) << (3 * BUCKET_LEVEL_BITS)) - 1)
+#define BIN_HEAP_SZ             4
+#define NO_RESIDUAL             UINT32_MAX
+
+/* min-heap of bins */
+typedef struct bin_heap bin_heap_t;
+struct bin_heap {
+        uint32_t *bins;
+        uint32_t len;
+        uint32_t size;
+};
+typedef struct buckets buckets_t;
+struct buckets {
+        /* bit v of top is set when summary[v] is not 0, bit w of
+         * summary when words[w] is not 0, and bit r of words when there
+         * are bins with residual r */
+        uint64_t top;
+        uint64_t *summary;
+        uint64_t *words;
+        bin_heap_t *heaps;
+};
+
+static void bin_heap_push(bin_heap_t *h, uint32_t bin) {
+        if (h->len == h->size) {
+                h->size = (h->size > 0) ? 2 * h->size : BIN_HEAP_SZ;
+                h->bins = realloc(h->bins, h->size * sizeof(*h->bins));
+        }
+        uint32_t i = h->len++;
+        for (; (i > 0) && (h->bins[(i - 1) / 2] > bin); i = (i - 1) / 2) {
+                h->bins[i] = h->bins[(i - 1) / 2];
+        }
+        h->bins[i] = bin;
+}
+static uint32_t bin_heap_pop(bin_heap_t *h) {
+        uint32_t top = h->bins[0];
+        uint32_t last = h->bins[--h->len];
+        uint32_t i = 0;
+        for (;;) {
+                uint32_t c = 2*i + 1;
+                if (c >= h->len) {
+                        break;
+                }
+                c += (c + 1 < h->len) && (h->bins[c + 1] < h->bins[c]);
+                if (h->bins[c] >= last) {
+                        break;
+                }
+                h->bins[i] = h->bins[c];
+                i = c;
+        }
+        h->bins[i] = last;
+        return top;
+}
+
+/** Returns the bits of word from bit b up */
+static inline uint64_t bits_from(uint64_t word, unsigned b) {
+        return (b < 64) ? word & (~UINT64_C(0) << b) : 0;
+}
+static void buckets_init(buckets_t *bk, uint32_t cap) {
+        size_t num_words = ((size_t)cap >> BUCKET_LEVEL_BITS) + 1;
+        size_t num_summary = (num_words >> BUCKET_LEVEL_BITS) + 1;
+        *bk = (buckets_t){
+                .summary = calloc(num_summary, sizeof(*bk->summary)),
+                .words = calloc(num_words, sizeof(*bk->words)),
+                .heaps = calloc((size_t)cap + 1, sizeof(*bk->heaps))};
+}
+static void buckets_free(buckets_t *bk, uint32_t cap) {
+        for (size_t r=0; r<=cap; r++) {
+                free(bk->heaps[r].bins);
+        }
+        free(bk->heaps);
+        free(bk->words);
+        free(bk->summary);
+}
+static void buckets_add(buckets_t *bk, uint32_t res, uint32_t bin) {
+        bin_heap_push(&bk->heaps[res], bin);
+        uint32_t w = res >> BUCKET_LEVEL_BITS;
+        uint32_t v = w >> BUCKET_LEVEL_BITS;
+        bk->words[w] |= UINT64_C(1) << (res & 63);
+        bk->summary[v] |= UINT64_C(1) << (w & 63);
+        bk->top |= UINT64_C(1) << v;
+}
+/** Takes the first bin with residual res out */
+static uint32_t buckets_take(buckets_t *bk, uint32_t res) {
+        bin_heap_t *h = &bk->heaps[res];
+        uint32_t bin = bin_heap_pop(h);
+        if (h->len > 0) {
+                return bin;
+        }
+        uint32_t w = res >> BUCKET_LEVEL_BITS;
+        uint32_t v = w >> BUCKET_LEVEL_BITS;
+        if ((bk->words[w] &= ~(UINT64_C(1) << (res & 63))) == 0
+            && (bk->summary[v] &= ~(UINT64_C(1) << (w & 63))) == 0) {
+                bk->top &= ~(UINT64_C(1) << v);
+        }
+        return bin;
+}
+/** Returns the least residual of at least res that a bin has, or
+ * NO_RESIDUAL */
+static uint32_t buckets_next(const buckets_t *bk, uint32_t res) {
+        uint32_t w = res >> BUCKET_LEVEL_BITS;
+        uint64_t bits = bits_from(bk->words[w], res & 63);
+        if (bits == 0) {
+                uint32_t v = w >> BUCKET_LEVEL_BITS;
+                uint64_t words = bits_from(bk->summary[v], (w & 63) + 1);
+                if (words == 0) {
+                        uint64_t summary = bits_from(bk->top, v + 1);
+                        if (summary == 0) {
+                                return NO_RESIDUAL;
+                        }
+                        v = __builtin_ctzll(summary);
+                        words = bk->summary[v];
+                }
+                w = (v << BUCKET_LEVEL_BITS) | __builtin_ctzll(words);
+                bits = bk->words[w];
+        }
+        return (w << BUCKET_LEVEL_BITS) | __builtin_ctzll(bits);
+}
+/** Returns the largest residual a bin has, or NO_RESIDUAL */
+static uint32_t buckets_max(const buckets_t *bk) {
+        if (bk->top == 0) {
+                return NO_RESIDUAL;
+        }
+        uint32_t v = 63 - __builtin_clzll(bk->top);
+        uint32_t w = (v << BUCKET_LEVEL_BITS)
+                     | (63 - __builtin_clzll(bk->summary[v]));
+        return (w << BUCKET_LEVEL_BITS) | (63 - __builtin_clzll(bk->words[w]));
+}
+
+/* The B-tree holds a key per open bin, its residual over its index, so
+ * that keys order the bins as above. Node j's key i is a lower bound of
+ * the keys under its child i, and the first of them is not used. Nodes
+ * are split when they fill up, but never merged: a node is only dropped
+ * when it empties. Every bin has one key removed and one added per item,
+ * so the tree never shrinks much and the depth stays O(log n). */
+#define BT_ORDER        32
+#define BT_NODES_SZ     64
+#define BT_NONE         UINT32_MAX
+
+typedef struct bt_node bt_node_t;
+struct bt_node {
+        uint32_t count;
+        bool leaf;
+        uint64_t keys[BT_ORDER];
+        /* of the internal nodes; child[0] links the free ones */
+        uint32_t child[BT_ORDER];
+};
+typedef struct btree btree_t;
+struct btree {
+        uint32_t root;
+        uint32_t free;
+        uint32_t num_nodes;
+        uint32_t size;
+        bt_node_t *nodes;
+};
+
+static uint32_t bt_node_new(btree_t *bt, bool leaf) {
+        uint32_t n = bt->free;
+        if (n != BT_NONE) {
+                bt->free = bt->nodes[n].child[0];
+        } else {
+                if (bt->num_nodes == bt->size) {
+                        bt->size *= 2;
+                        bt->nodes = realloc(bt->nodes,
+                                            bt->size * sizeof(*bt->nodes));
+                }
+                n = bt->num_nodes++;
+        }
+        bt->nodes[n].count = 0;
+        bt->nodes[n].leaf = leaf;
+        return n;
+}
+static void bt_node_free(btree_t *bt, uint32_t n) {
+        bt->nodes[n].child[0] = bt->free;
+        bt->free = n;
+}
+static void bt_init(btree_t *bt) {
+        *bt = (btree_t){.free = BT_NONE,
+                        .size = BT_NODES_SZ,
+                        .nodes = malloc(BT_NODES_SZ * sizeof(*bt->nodes))};
+        bt->root = bt_node_new(bt, true);
+}
+/** Returns the child of node whose keys key falls among */
+static inline uint32_t bt_route(const bt_node_t *node, uint64_t key) {
+        uint32_t i = 0;
+        for (uint32_t j=1; j<node->count; j++) {
+                i += (node->keys[j] <= key);
+        }
+        return i;
+}
+static void bt_node_insert(bt_node_t *node, uint32_t i, uint64_t key,
+                           uint32_t child) {
+        memmove(node->keys + i + 1, node->keys + i,
+                (node->count - i) * sizeof(*node->keys));
+        node->keys[i] = key;
+        if (!node->leaf) {
+                memmove(node->child + i + 1, node->child + i,
+                        (node->count - i) * sizeof(*node->child));
+                node->child[i] = child;
+        }
+        node->count++;
+}
+static void bt_node_erase(bt_node_t *node, uint32_t i) {
+        memmove(node->keys + i, node->keys + i + 1,
+                (node->count - i - 1) * sizeof(*node->keys));
+        if (!node->leaf) {
+                memmove(node->child + i, node->child + i + 1,
+                        (node->count - i - 1) * sizeof(*node->child));
+        }
+        node->count--;
+}
+/** Adds key under node n; if n splits, returns its new right half and
+ * sets *split to the half's lower bound, else returns BT_NONE */
+static uint32_t bt_insert_at(btree_t *bt, uint32_t n, uint64_t key,
+                             uint64_t *split) {
+        bt_node_t *node = &bt->nodes[n];
+        if (node->leaf) {
+                uint32_t i = 0;
+                while ((i < node->count) && (node->keys[i] < key)) {
+                        i++;
+                }
+                bt_node_insert(node, i, key, 0);
+        } else {
+                uint32_t i = bt_route(node, key);
+                uint64_t child_split;
+                uint32_t half = bt_insert_at(bt, node->child[i], key,
+                                             &child_split);
+                if (half == BT_NONE) {
+                        return BT_NONE;
+                }
+                /* the child may have moved the nodes */
+                node = &bt->nodes[n];
+                bt_node_insert(node, i + 1, child_split, half);
+        }
+        if (node->count < BT_ORDER) {
+                return BT_NONE;
+        }
+        uint32_t half = bt_node_new(bt, node->leaf);
+        node = &bt->nodes[n];
+        bt_node_t *right = &bt->nodes[half];
+        right->count = BT_ORDER / 2;
+        node->count = BT_ORDER - right->count;
+        memcpy(right->keys, node->keys + node->count,
+               right->count * sizeof(*right->keys));
+        memcpy(right->child, node->child + node->count,
+               right->count * sizeof(*right->child));
+        *split = right->keys[0];
+        return half;
+}
+static void bt_insert(btree_t *bt, uint64_t key) {
+        uint64_t split;
+        uint32_t half = bt_insert_at(bt, bt->root, key, &split);
+        if (half != BT_NONE) {
+                uint32_t root = bt_node_new(bt, false);
+                bt_node_t *node = &bt->nodes[root];
+                node->count = 2;
+                node->keys[1] = split;
+                node->child[0] = bt->root;
+                node->child[1] = half;
+                bt->root = root;
+        }
+}
+/** Takes the least key of at least min from under node n into *key;
+ * returns false if there is none. Sets *emptied if n is left empty. */
+static bool bt_take_at(btree_t *bt, uint32_t n, uint64_t min, uint64_t *key,
+                       bool *emptied) {
+        bt_node_t *node = &bt->nodes[n];
+        if (node->leaf) {
+                uint32_t i = 0;
+                while ((i < node->count) && (node->keys[i] < min)) {
+                        i++;
+                }
+                if (i == node->count) {
+                        return false;
+                }
+                *key = node->keys[i];
+                bt_node_erase(node, i);
+                *emptied = (node->count == 0);
+                return true;
+        }
+        /* past the first child tried, every key is at least min */
+        for (uint32_t i=bt_route(node, min); i<node->count; i++) {
+                bool child_emptied = false;
+                if (bt_take_at(bt, node->child[i], min, key,
+                               &child_emptied)) {
+                        if (child_emptied) {
+                                bt_node_free(bt, node->child[i]);
+                                bt_node_erase(node, i);
+                        }
+                        *emptied = (node->count == 0);
+                        return true;
+                }
+        }
+        return false;
+}
+static bool bt_take(btree_t *bt, uint64_t min, uint64_t *key) {
+        bool emptied = false;
+        if (!bt_take_at(bt, bt->root, min, key, &emptied)) {
+                return false;
+        }
+        if (emptied) {
+                bt->nodes[bt->root].leaf = true;
+        }
+        while (!bt->nodes[bt->root].leaf
+               && (bt->nodes[bt->root].count == 1)) {
+                uint32_t root = bt->root;
+                bt->root = bt->nodes[root].child[0];
+                bt_node_free(bt, root);
+        }
+        return true;
+}
+/** Sets *key to the largest key; returns false if there is none */
+static bool bt_max(const btree_t *bt, uint64_t *key) {
+        uint32_t n = bt->root;
+        while (!bt->nodes[n].leaf) {
+                n = bt->nodes[n].child[bt->nodes[n].count - 1];
+        }
+        if (bt->nodes[n].count == 0) {
+                return false;
+        }
+        *key = bt->nodes[n].keys[bt->nodes[n].count - 1];
+        return true;
+}
+
+/* the open bins of a best-fit or worst-fit packing, in either index */
+typedef struct fit fit_t;
+struct fit {
+        bool worst;
+        bool use_buckets;
+        uint32_t cap;
+        /* bins with less room than this, the smallest item, can take no
+         * more items and are left out */
+        uint32_t min_size;
+        size_t num_bins;
+        buckets_t buckets;
+        btree_t bt;
+};
+
+static void fit_init(fit_t *f, uint32_t cap, uint32_t min_size, bool worst) {
+        *f = (fit_t){.worst = worst,
+                     .use_buckets = (cap <= BUCKET_MAX_CAP),
+                     .cap = cap,
+                     .min_size = min_size};
+        if (f->use_buckets) {
+                buckets_init(&f->buckets, cap);
+        } else {
+                bt_init(&f->bt);
+        }
+}
+static void fit_free(fit_t *f) {
+        if (f->use_buckets) {
+                buckets_free(&f->buckets, f->cap);
+        } else {
+                free(f->bt.nodes);
+        }
+}
+/** Puts an item of the given size in the bin the rule picks, opening a
+ * new one if it fits in none; returns the bin */
+static inline uint32_t fit_place(fit_t *f, uint32_t size) {
+        uint32_t bin = f->num_bins;
+        uint32_t res = f->cap;
+        if (f->use_buckets) {
+                uint32_t found = f->worst ? buckets_max(&f->buckets)
+                                          : buckets_next(&f->buckets, size);
+                if ((found != NO_RESIDUAL) && (found >= size)) {
+                        res = found;
+                        bin = buckets_take(&f->buckets, res);
+                }
+                if (res - size >= f->min_size) {
+                        buckets_add(&f->buckets, res - size, bin);
+                }
+        } else {
+                uint64_t key;
+                bool found;
+                if (f->worst) {
+                        /* the first bin of the largest residual */
+                        found = bt_max(&f->bt, &key) && ((key >> 32) >= size)
+                                && bt_take(&f->bt, key >> 32 << 32, &key);
+                } else {
+                        found = bt_take(&f->bt, (uint64_t)size << 32, &key);
+                }
+                if (found) {
+                        res = key >> 32;
+                        bin = (uint32_t)key;
+                }
+                if (res - size >= f->min_size) {
+                        bt_insert(&f->bt,
+                                  ((uint64_t)(res - size) << 32) | bin);
+                }
+        }
+        if (bin == f->num_bins) {
+                f->num_bins++;
+        }
+        return bin;
+}
+/** Best-fit, or worst-fit, with the items in index order or by decreasing
+ * size */
+static size_t pack_fit(const uint32_t *sizes, size_t num_items,
+                       uint32_t cap, uint32_t *assign, bool worst,
+                       bool decreasing) {
+        if (num_items == 0) {
+                return 0;
+        }
+        assert(num_items <= UINT32_MAX);
+        uint32_t min_size = UINT32_MAX;
+        for (size_t i=0; i<num_items; i++) {
+                min_size = (sizes[i] < min_size) ? sizes[i] : min_size;
+        }
+        fit_t f;
+        fit_init(&f, cap, min_size, worst);
+        if (decreasing) {
+                uint64_t *keyed = sort_decreasing(sizes, num_items);
+                for (size_t k=0; k<num_items; k++) {
+                        uint32_t size = ~(uint32_t)(keyed[k] >> 32);
+                        assert(size <= cap);
+                        assign[(uint32_t)keyed[k]] = fit_place(&f, size);
+                }
+                free(keyed);
+        } else {
+                for (size_t i=0; i<num_items; i++) {
+                        assert(sizes[i] <= cap);
+                        assign[i] = fit_place(&f, sizes[i]);
+                }
+        }
+        fit_free(&f);
+        return f.num_bins;
+}
+
+size_t pack_ff(const uint32_t *sizes, size_t num_items, uint32_t cap,
+               uint32_t *assign) {
+        assert(num_items <= UINT32_MAX);
+        res_tree_t t;
+        res_tree_init(&t, cap);
+        size_t num_bins = 0;
+        for (size_t i=0; i<num_items; i++) {
+                assert(sizes[i] <= cap);
+                assign[i] = res_tree_first_fit(&t, &num_bins, sizes[i]);
+        }
+        free(t.node);
+        return num_bins;
+}
+size_t pack_ffd(const uint32_t *sizes, size_t num_items, uint32_t cap,
+                uint32_t *assign) {
+        if (num_items == 0) {
+                return 0;
+        }
+        assert(num_items <= UINT32_MAX);
+        uint64_t *keyed = sort_decreasing(sizes, num_items);
+        res_tree_t t;
+        res_tree_init(&t, cap);
+        size_t num_bins = 0;
+        for (size_t k=0; k<num_items; k++) {
+                uint32_t size = ~(uint32_t)(keyed[k] >> 32);
+                assert(size <= cap);
+                assign[(uint32_t)keyed[k]] = res_tree_first_fit(
+                        &t, &num_bins, size);
+        }
+        free(t.node);
+        free(keyed);
+        return num_bins;
+}
+size_t pack_bf(const uint32_t *sizes, size_t num_items, uint32_t cap,
+               uint32_t *assign) {
+        return pack_fit(sizes, num_items, cap, assign, false, false);
+}
+size_t pack_bfd(const uint32_t *sizes, size_t num_items, uint32_t cap,
+                uint32_t *assign) {
+        return pack_fit(sizes, num_items, cap, assign, false, true);
+}
+size_t pack_wf(const uint32_t *sizes, size_t num_items, uint32_t cap,
+               uint32_t *assign) {
+        return pack_fit(sizes, num_items, cap, assign, true, false);
+}
+size_t pack(pack_rule_t rule, const uint32_t *sizes, size_t num_items,
+            uint32_t cap, uint32_t *assign) {
+        switch (rule) {
+        case PACK_FF:
+                return pack_ff(sizes, num_items, cap, assign);
+        case PACK_FFD:
+                return pack_ffd(sizes, num_items, cap, assign);
+        case PACK_BF:
+                return pack_bf(sizes, num_items, cap, assign);
+        case PACK_BFD:
+                return pack_bfd(sizes, num_items, cap, assign);
+        default:
+                return pack_wf(sizes, num_items, cap, assign);
+        }
+}
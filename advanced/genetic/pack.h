@@ -0,0 +1,51 @@
+#ifndef PACK_H
+#define PACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Native versions of the heuristics in heuristics/, for integer sizes,
+ * that keep up with tens of millions of items. Each packs the num_items
+ * items of sizes, none of them larger than cap, into bins of capacity
+ * cap: it sets assign[i] to the bin of item i, the bins being numbered
+ * in the order they were opened, and returns the number of bins. Items
+ * go where the Python versions put them. */
+
+/** First-fit, as run_ff_segment_tree() in heuristics/firstfit/ff.py, in
+ * O(n log n) */
+size_t pack_ff(const uint32_t *sizes, size_t num_items, uint32_t cap,
+               uint32_t *assign);
+/** First-fit decreasing, as run_ffd() in
+ * heuristics/firstfitdecreasing/ffd.py: first-fit on the items by
+ * decreasing size, equal ones in index order, which a radix sort finds
+ * in O(n) */
+size_t pack_ffd(const uint32_t *sizes, size_t num_items, uint32_t cap,
+                uint32_t *assign);
+/** Best-fit, as run_bf() in heuristics/bestfit/bf.py: each item goes to
+ * the bin it leaves the least room in, the first such one, in
+ * O(n log n) */
+size_t pack_bf(const uint32_t *sizes, size_t num_items, uint32_t cap,
+               uint32_t *assign);
+/** Best-fit decreasing, as run_bfd() in
+ * heuristics/bestfitdecreasing/bfd.py */
+size_t pack_bfd(const uint32_t *sizes, size_t num_items, uint32_t cap,
+                uint32_t *assign);
+/** Worst-fit: each item goes to the bin with the most room, the first
+ * such one, if it fits there */
+size_t pack_wf(const uint32_t *sizes, size_t num_items, uint32_t cap,
+               uint32_t *assign);
+/* the heuristics, for callers that pick one at run time */
+typedef enum pack_rule pack_rule_t;
+enum pack_rule {
+        PACK_FF,
+        PACK_FFD,
+        PACK_BF,
+        PACK_BFD,
+        PACK_WF
+};
+
+/** Packs with the given heuristic */
+size_t pack(pack_rule_t rule, const uint32_t *sizes, size_t num_items,
+            uint32_t cap, uint32_t *assign);
+
+#endif /* !PACK_H */
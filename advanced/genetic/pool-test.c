@@ -0,0 +1,33 @@
+#include "pool.h"
+#include <stdio.h>
+#include <stdatomic.h>
+
+#define NUM_TASKS       10000
+#define MAX_THREADS     8
+
+static atomic_uint runs[NUM_TASKS];
+
+static void count_run(void *arg, size_t task) {
+        (void)arg;
+        atomic_fetch_add(&runs[task], 1);
+}
+
+int main(void) {
+        for (size_t threads=1; threads<=MAX_THREADS; threads*=2) {
+                for (size_t i=0; i<NUM_TASKS; i++) {
+                        atomic_init(&runs[i], 0);
+                }
+                pool_join(pool_start(threads, NUM_TASKS, count_run, NULL));
+                size_t once = 0;
+                for (size_t i=0; i<NUM_TASKS; i++) {
+                        once += (atomic_load(&runs[i]) == 1);
+                }
+                printf("%zu threads: tasks run once: %zu of %d\n",
+                       threads, once, NUM_TASKS);
+        }
+        /* more threads than tasks */
+        atomic_init(&runs[0], 0);
+        pool_join(pool_start(MAX_THREADS, 1, count_run, NULL));
+        printf("one task: runs: %u\n", atomic_load(&runs[0]));
+        return 0;
+}
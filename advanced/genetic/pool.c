@@ -0,0 +1,146 @@
+#include "pool.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+/* Chase-Lev deque that is only filled before the threads start: the
+ * owner pops at the bottom, thieves take from the top, and only a claim
+ * on the last task can race, which a compare-and-swap on top settles. */
+typedef struct deque deque_t;
+struct deque {
+        _Alignas(64) atomic_int_least64_t top;
+        atomic_int_least64_t bottom;
+        /* stored highest first, so the owner pops lowest first */
+        size_t *tasks;
+};
+typedef struct pool_thread pool_thread_t;
+struct pool_thread {
+        pthread_t thread;
+        pool_t *pool;
+        size_t index;
+};
+struct pool {
+        pool_fn_t *fn;
+        void *arg;
+        size_t num_threads;
+        deque_t *deques;
+        size_t *tasks;
+        pool_thread_t *threads;
+};
+
+/** Pops the bottom task of d into *task; returns false if it is empty */
+static bool deque_pop(deque_t *d, size_t *task) {
+        int_least64_t b = atomic_load_explicit(&d->bottom,
+                                               memory_order_relaxed) - 1;
+        atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        int_least64_t t = atomic_load_explicit(&d->top,
+                                               memory_order_relaxed);
+        if (t > b) {
+                atomic_store_explicit(&d->bottom, b + 1,
+                                      memory_order_relaxed);
+                return false;
+        }
+        *task = d->tasks[b];
+        if (t < b) {
+                return true;
+        }
+        /* the last task: a thief may be taking it too */
+        bool won = atomic_compare_exchange_strong_explicit(
+                &d->top, &t, t + 1,
+                memory_order_seq_cst, memory_order_relaxed);
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        return won;
+}
+/** Takes the top task of d into *task; returns false if it is empty or
+ * another thread took it first */
+static bool deque_steal(deque_t *d, size_t *task) {
+        int_least64_t t = atomic_load_explicit(&d->top,
+                                               memory_order_acquire);
+        atomic_thread_fence(memory_order_seq_cst);
+        int_least64_t b = atomic_load_explicit(&d->bottom,
+                                               memory_order_acquire);
+        if (t >= b) {
+                return false;
+        }
+        *task = d->tasks[t];
+        return atomic_compare_exchange_strong_explicit(
+                &d->top, &t, t + 1,
+                memory_order_seq_cst, memory_order_relaxed);
+}
+static bool deque_empty(deque_t *d) {
+        return atomic_load_explicit(&d->top, memory_order_acquire)
+               >= atomic_load_explicit(&d->bottom, memory_order_acquire);
+}
+
+static void *pool_thread_main(void *arg) {
+        pool_thread_t *self = arg;
+        pool_t *pool = self->pool;
+        size_t task;
+        while (deque_pop(&pool->deques[self->index], &task)) {
+                pool->fn(pool->arg, task);
+        }
+        /* no task is ever added, so once every deque is seen empty the
+         * work is done; a lost race is retried */
+        for (bool all_empty=false; !all_empty; ) {
+                all_empty = true;
+                for (size_t i=1; i<pool->num_threads; i++) {
+                        size_t v = (self->index + i) % pool->num_threads;
+                        deque_t *victim = &pool->deques[v];
+                        while (!deque_empty(victim)) {
+                                all_empty = false;
+                                if (deque_steal(victim, &task)) {
+                                        pool->fn(pool->arg, task);
+                                }
+                        }
+                }
+        }
+        return NULL;
+}
+
+pool_t *pool_start(size_t num_threads, size_t num_tasks, pool_fn_t *fn,
+                   void *arg) {
+        pool_t *pool = malloc(sizeof(*pool));
+        *pool = (pool_t){.fn = fn,
+                         .arg = arg,
+                         .num_threads = num_threads,
+                         .deques = aligned_alloc(
+                                 _Alignof(deque_t),
+                                 num_threads * sizeof(*pool->deques)),
+                         .tasks = malloc(num_tasks * sizeof(*pool->tasks)),
+                         .threads = malloc(num_threads
+                                           * sizeof(*pool->threads))};
+        /* thread i gets tasks i, i + num_threads, ...; its slice of
+         * tasks holds them highest first */
+        size_t *slice = pool->tasks;
+        for (size_t i=0; i<num_threads; i++) {
+                size_t count = (num_tasks + num_threads - 1 - i)
+                               / num_threads;
+                for (size_t j=0; j<count; j++) {
+                        slice[j] = i + ((count - 1 - j) * num_threads);
+                }
+                deque_t *d = &pool->deques[i];
+                d->tasks = slice;
+                atomic_init(&d->top, 0);
+                atomic_init(&d->bottom, count);
+                slice += count;
+        }
+        for (size_t i=0; i<num_threads; i++) {
+                pool->threads[i] = (pool_thread_t){.pool = pool,
+                                                   .index = i};
+                pthread_create(&pool->threads[i].thread, NULL,
+                               pool_thread_main, &pool->threads[i]);
+        }
+        return pool;
+}
+void pool_join(pool_t *pool) {
+        for (size_t i=0; i<pool->num_threads; i++) {
+                pthread_join(pool->threads[i].thread, NULL);
+        }
+        free(pool->threads);
+        free(pool->tasks);
+        free(pool->deques);
+        free(pool);
+}
@@ -0,0 +1,20 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+/* Work-stealing pool running a fixed batch of tasks 0..num_tasks-1. The
+ * tasks are dealt round-robin to per-thread deques, in order, so that
+ * with even tasks they finish roughly in order. A thread runs its own
+ * tasks lowest first and, once out of them, steals the highest task of
+ * another thread. */
+typedef struct pool pool_t;
+typedef void pool_fn_t(void *arg, size_t task);
+
+/** Starts running fn(arg, task) for every task on num_threads threads */
+pool_t *pool_start(size_t num_threads, size_t num_tasks, pool_fn_t *fn,
+                   void *arg);
+/** Waits for all tasks of pool to finish and frees it */
+void pool_join(pool_t *pool);
+
+#endif /* !POOL_H */
@@ -5,13 +5,14 @@
 #define POP_SZ          10
 #define ARR_SZ          20
 #define TEST_CAP        1000
+#define ARENA_BLOCK_SZ  4096
+#define FITNESS_K       2
+#define SEED            3
 
-static void print_bin(const bin_t *bin,
-                      const long double *item_sizes, size_t num_items);
-static void print_chrom(const chrom_t *chrom,
-                        const long double *item_sizes, size_t num_items);
-static void print_pop(const pop_t *pop,
-                      const long double *item_sizes, size_t num_items);
+static void print_bin(const chrom_t *chrom, const bin_t *bin,
+                      const sizes_t *sizes);
+static void print_chrom(const chrom_t *chrom, const sizes_t *sizes);
+static void print_pop(const pop_t *pop, const sizes_t *sizes);
 
 int main(void) {
         srand(3);
@@ -23,47 +24,50 @@ int main(void) {
         }
         putchar('\n');
         printf("rand pop\n");
-        pop_t *pop = pop_rand_init(TEST_CAP, POP_SZ, arr, ARR_SZ);
+        arena_t *arena = arena_new(ARENA_BLOCK_SZ);
+        chrom_ws_t *ws = chrom_ws_new(ARR_SZ, FITNESS_K, REPAIR_FF, false,
+                                      SEED);
+        sizes_t *sizes = sizes_new(arena, arr, ARR_SZ, TEST_CAP);
+        pop_t *pop = pop_rand_init(arena, ws, POP_SZ, sizes);
         printf("pop:\n");
-        print_pop(pop, arr, ARR_SZ);
+        print_pop(pop, sizes);
         printf("free\n");
-        pop_free(pop);
+        arena_free(arena);
+        chrom_ws_free(ws);
         free(arr);
         return 0;
 }
 
-static void print_bin(const bin_t *bin,
-                      const long double *item_sizes, size_t num_items) {
+static void print_bin(const chrom_t *chrom, const bin_t *bin,
+                      const sizes_t *sizes) {
         printf("fill: %Lf\n"
                "count: %zu\n"
                "items:\n",
-               bin->fill, bin->count);
+               sizes_fill(sizes, &bin->fill), bin->count);
         for (size_t i=0; i<bin->count; i++) {
+                size_t index = chrom_item(chrom, bin->start + i);
                 printf("index: %zu\tsize: %Lf\n",
-                       bin->item_indices[i],
-                       item_sizes[bin->item_indices[i]]);
+                       index, sizes->orig[index]);
         }
 }
-static void print_chrom(const chrom_t *chrom,
-                        const long double *item_sizes, size_t num_items) {
+static void print_chrom(const chrom_t *chrom, const sizes_t *sizes) {
         printf("fitness: %lf\n"
                "bin_cap: %Lf\n"
                "num_bins: %zu\n"
                "bins:\n",
-               chrom->fitness, chrom->bin_cap, chrom->num_bins);
+               chrom->fitness, sizes->bin_cap, chrom->num_bins);
         for (size_t i=0; i<chrom->num_bins; i++) {
                 printf("bin %zu:\n", i);
-                print_bin(chrom->bins[i], item_sizes, num_items);
+                print_bin(chrom, &chrom->bins[i], sizes);
         }
 }
-static void print_pop(const pop_t *pop,
-                      const long double *item_sizes, size_t num_items) {
+static void print_pop(const pop_t *pop, const sizes_t *sizes) {
         printf("num_chroms: %zu\n"
                "chroms:\n",
                pop->num_chroms);
         for (size_t i=0; i<pop->num_chroms; i++) {
                 printf("chrom %zu:\n", i);
-                print_chrom(pop->chroms[i], item_sizes, num_items);
+                print_chrom(pop->chroms[i], sizes);
         }
         putchar('\n');
 }
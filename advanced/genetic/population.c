@@ -1,30 +1,26 @@
 #include "population.h"
-#include <stdlib.h>
 #include <string.h>
 
-pop_t *pop_alloc(size_t pop_size) {
-        pop_t *pop = malloc(offsetof(pop_t, chroms)
-                            + (pop_size * sizeof(*pop->chroms)));
+pop_t *pop_alloc(arena_t *arena, size_t pop_size) {
+        pop_t *pop = arena_alloc(arena, offsetof(pop_t, chroms)
+                                        + (pop_size * sizeof(*pop->chroms)));
         memcpy((size_t *)&pop->num_chroms, &pop_size,
                sizeof(pop->num_chroms));
         memset(&pop->chroms, 0, pop->num_chroms * sizeof(*pop->chroms));
         return pop;
 }
-pop_t *pop_rand_init(long double bin_capacity, size_t pop_size,
-                     const long double *item_sizes, size_t num_items) {
-        pop_t *pop = pop_alloc(pop_size);
+pop_t *pop_alloc_chroms(arena_t *arena, size_t pop_size, size_t num_items) {
+        pop_t *pop = pop_alloc(arena, pop_size);
         for (size_t i=0; i<pop->num_chroms; i++) {
-                pop->chroms[i] = rand_first_fit(item_sizes, num_items,
-                                                bin_capacity);
+                pop->chroms[i] = chrom_alloc(arena, num_items);
         }
         return pop;
 }
-void pop_free(pop_t *pop) {
-        if (pop == NULL) {
-                return;
-        }
+pop_t *pop_rand_init(arena_t *arena, chrom_ws_t *ws, size_t pop_size,
+                     const sizes_t *sizes) {
+        pop_t *pop = pop_alloc_chroms(arena, pop_size, sizes->num_items);
         for (size_t i=0; i<pop->num_chroms; i++) {
-                chrom_free(pop->chroms[i]);
+                rand_first_fit(ws, pop->chroms[i], sizes);
         }
-        free(pop);
+        return pop;
 }
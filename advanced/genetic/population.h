@@ -9,9 +9,11 @@ struct population {
         chrom_t *chroms[];
 };
 
-pop_t *pop_alloc(size_t pop_size);
-pop_t *pop_rand_init(long double bin_capacity, size_t pop_size,
-                     const long double *item_sizes, size_t num_items);
-void pop_free(pop_t *pop);
+/* populations, like their chromosomes, live in the given arena */
+pop_t *pop_alloc(arena_t *arena, size_t pop_size);
+/* a population of empty chromosomes, to be overwritten in place */
+pop_t *pop_alloc_chroms(arena_t *arena, size_t pop_size, size_t num_items);
+pop_t *pop_rand_init(arena_t *arena, chrom_ws_t *ws, size_t pop_size,
+                     const sizes_t *sizes);
 
 #endif /* !POPULATION_H */
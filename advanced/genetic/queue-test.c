@@ -0,0 +1,61 @@
+#include "queue.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#define CAPACITY        64
+#define NUM_THREADS     4
+#define NUM_ITEMS       100000
+
+static queue_t *queue;
+static atomic_size_t sum;
+static atomic_size_t popped;
+
+/* pushes 1..NUM_ITEMS, retrying while the queue is full */
+static void *producer(void *arg) {
+        (void)arg;
+        for (uintptr_t i=1; i<=NUM_ITEMS; i++) {
+                while (!queue_push(queue, (void *)i)) {
+                }
+        }
+        return NULL;
+}
+static void *consumer(void *arg) {
+        (void)arg;
+        while (atomic_load(&popped) < NUM_THREADS * NUM_ITEMS) {
+                void *data;
+                if (queue_pop(queue, &data)) {
+                        atomic_fetch_add(&sum, (uintptr_t)data);
+                        atomic_fetch_add(&popped, 1);
+                }
+        }
+        return NULL;
+}
+
+int main(void) {
+        queue = queue_new(CAPACITY);
+        void *data;
+        printf("empty pop: %d\n", !queue_pop(queue, &data));
+        size_t pushed = 0;
+        while (queue_push(queue, NULL)) {
+                pushed++;
+        }
+        printf("full after: %zu\n", pushed);
+        while (queue_pop(queue, &data)) {
+        }
+        pthread_t producers[NUM_THREADS], consumers[NUM_THREADS];
+        for (size_t t=0; t<NUM_THREADS; t++) {
+                pthread_create(&producers[t], NULL, producer, NULL);
+                pthread_create(&consumers[t], NULL, consumer, NULL);
+        }
+        for (size_t t=0; t<NUM_THREADS; t++) {
+                pthread_join(producers[t], NULL);
+                pthread_join(consumers[t], NULL);
+        }
+        size_t expected = (size_t)NUM_THREADS * NUM_ITEMS * (NUM_ITEMS + 1)
+                          / 2;
+        printf("every item popped once: %d\n", atomic_load(&sum) == expected);
+        queue_free(queue);
+        return 0;
+}
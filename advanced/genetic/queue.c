@@ -0,0 +1,95 @@
+#include "queue.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+typedef struct cell cell_t;
+struct cell {
+        /* pos when the cell may be written for the push at pos, and
+         * pos + 1 once it may be read by the pop at pos */
+        atomic_size_t seq;
+        void *data;
+};
+struct queue {
+        size_t mask;
+        cell_t *cells;
+        /* on lines of their own, as producers and consumers differ */
+        _Alignas(64) atomic_size_t tail;
+        _Alignas(64) atomic_size_t head;
+};
+
+queue_t *queue_new(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+                size *= 2;
+        }
+        queue_t *queue = aligned_alloc(_Alignof(queue_t), sizeof(*queue));
+        queue->mask = size - 1;
+        queue->cells = malloc(size * sizeof(*queue->cells));
+        for (size_t i=0; i<size; i++) {
+                atomic_init(&queue->cells[i].seq, i);
+        }
+        atomic_init(&queue->tail, 0);
+        atomic_init(&queue->head, 0);
+        return queue;
+}
+void queue_free(queue_t *queue) {
+        free(queue->cells);
+        free(queue);
+}
+bool queue_push(queue_t *queue, void *data) {
+        size_t pos = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+        cell_t *cell;
+        for (;;) {
+                cell = &queue->cells[pos & queue->mask];
+                size_t seq = atomic_load_explicit(&cell->seq,
+                                                  memory_order_acquire);
+                intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+                if (diff == 0) {
+                        if (atomic_compare_exchange_weak_explicit(
+                                    &queue->tail, &pos, pos + 1,
+                                    memory_order_relaxed,
+                                    memory_order_relaxed)) {
+                                break;
+                        }
+                } else if (diff < 0) {
+                        /* the cell still holds an entry from a lap ago */
+                        return false;
+                } else {
+                        pos = atomic_load_explicit(&queue->tail,
+                                                   memory_order_relaxed);
+                }
+        }
+        cell->data = data;
+        atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+        return true;
+}
+bool queue_pop(queue_t *queue, void **data) {
+        size_t pos = atomic_load_explicit(&queue->head, memory_order_relaxed);
+        cell_t *cell;
+        for (;;) {
+                cell = &queue->cells[pos & queue->mask];
+                size_t seq = atomic_load_explicit(&cell->seq,
+                                                  memory_order_acquire);
+                intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+                if (diff == 0) {
+                        if (atomic_compare_exchange_weak_explicit(
+                                    &queue->head, &pos, pos + 1,
+                                    memory_order_relaxed,
+                                    memory_order_relaxed)) {
+                                break;
+                        }
+                } else if (diff < 0) {
+                        /* nothing pushed into the cell yet */
+                        return false;
+                } else {
+                        pos = atomic_load_explicit(&queue->head,
+                                                   memory_order_relaxed);
+                }
+        }
+        *data = cell->data;
+        /* free for the push a lap later */
+        atomic_store_explicit(&cell->seq, pos + queue->mask + 1,
+                              memory_order_release);
+        return true;
+}
@@ -0,0 +1,22 @@
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Bounded lock-free queue of pointers for any number of producers and
+ * consumers (Vyukov's): a ring of cells, each stamped with the turn in
+ * which it may next be written or read, so a push or pop only contends
+ * on one compare-and-swap of its own end. */
+typedef struct queue queue_t;
+
+/** Returns a queue of at least capacity entries */
+queue_t *queue_new(size_t capacity);
+void queue_free(queue_t *queue);
+/** Appends data; returns false if the queue is full */
+bool queue_push(queue_t *queue, void *data);
+/** Takes the oldest entry into *data; returns false if the queue is
+ * empty */
+bool queue_pop(queue_t *queue, void **data);
+
+#endif /* !QUEUE_H */
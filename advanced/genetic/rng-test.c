@@ -0,0 +1,63 @@
+#include "rng.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define SEED            3
+#define NUM_DRAWS       (16 * RNG_BATCH)
+#define BOUND           7
+
+static uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+}
+/* one lane of the generator, stepped the plain way */
+static uint64_t ref_next(uint64_t *s) {
+        uint64_t result = rotl(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+}
+
+int main(void) {
+        rng_t rng, other;
+        rng_seed(&rng, SEED);
+        rng_seed(&other, SEED);
+        /* draw with whichever kernel this machine has, and without AVX2 */
+        other.have_avx2 = false;
+        uint64_t lanes[RNG_LANES][4];
+        for (int l=0; l<RNG_LANES; l++) {
+                for (int i=0; i<4; i++) {
+                        lanes[l][i] = rng.s[i][l];
+                }
+        }
+        size_t ref_diffs = 0, kernel_diffs = 0;
+        for (size_t i=0; i<NUM_DRAWS; i++) {
+                uint64_t x = rng_next(&rng);
+                ref_diffs += (x != ref_next(lanes[i % RNG_LANES]));
+                kernel_diffs += (x != rng_next(&other));
+        }
+        printf("draws unlike the reference: %zu\n", ref_diffs);
+        printf("draws unlike the other kernel: %zu\n", kernel_diffs);
+
+        size_t counts[BOUND] = {0};
+        for (size_t i=0; i<NUM_DRAWS; i++) {
+                counts[rng_below(&rng, BOUND)]++;
+        }
+        printf("below %d:", BOUND);
+        for (size_t i=0; i<BOUND; i++) {
+                printf(" %zu", counts[i]);
+        }
+        printf("\n");
+        size_t outside = 0;
+        for (size_t i=0; i<NUM_DRAWS; i++) {
+                double u = rng_uniform(&rng);
+                outside += !((u >= 0) && (u < 1));
+        }
+        printf("uniforms outside [0, 1): %zu\n", outside);
+        return 0;
+}
@@ -0,0 +1,125 @@
+#include "rng.h"
+#if defined (__x86_64__) || defined (__i386__)
+#include <immintrin.h>
+#define HAVE_X86
+#endif
+
+void rng_seed(rng_t *rng, uint64_t seed) {
+        for (int l=0; l<RNG_LANES; l++) {
+                for (int i=0; i<4; i++) {
+                        uint64_t z = (seed += UINT64_C(0x9E3779B97F4A7C15));
+                        z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+                        z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+                        rng->s[i][l] = z ^ (z >> 31);
+                }
+        }
+        rng->pos = RNG_BATCH;
+#ifdef HAVE_X86
+        rng->have_avx2 = __builtin_cpu_supports("avx2");
+#else
+        rng->have_avx2 = false;
+#endif
+}
+
+/* All kernels lay the batch out alike: word l of every RNG_LANES comes
+ * from lane l, so they make the same stream. */
+static inline uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+}
+static void refill_scalar(rng_t *rng) {
+        uint64_t (*s)[RNG_LANES] = rng->s;
+        for (size_t i=0; i<RNG_BATCH; i+=RNG_LANES) {
+                for (int l=0; l<RNG_LANES; l++) {
+                        rng->buf[i + l] = rotl(s[1][l] * 5, 7) * 9;
+                        uint64_t t = s[1][l] << 17;
+                        s[2][l] ^= s[0][l];
+                        s[3][l] ^= s[1][l];
+                        s[1][l] ^= s[2][l];
+                        s[0][l] ^= s[3][l];
+                        s[2][l] ^= t;
+                        s[3][l] = rotl(s[3][l], 45);
+                }
+        }
+}
+#ifdef HAVE_X86
+/* there is no 64-bit lane multiply below AVX-512, but 5x = x + 4x and
+ * 9x = x + 8x */
+#ifdef __SSE2__
+static inline __m128i rotl_sse2(__m128i x, int k) {
+        return _mm_or_si128(_mm_slli_epi64(x, k), _mm_srli_epi64(x, 64 - k));
+}
+static void refill_sse2(rng_t *rng) {
+        _Static_assert(RNG_LANES == 4, "two lanes per SSE2 register");
+        __m128i s[4][2];
+        for (int i=0; i<4; i++) {
+                for (int h=0; h<2; h++) {
+                        s[i][h] = _mm_loadu_si128((__m128i *)&rng->s[i][2*h]);
+                }
+        }
+        for (size_t i=0; i<RNG_BATCH; i+=RNG_LANES) {
+                for (int h=0; h<2; h++) {
+                        __m128i x = _mm_add_epi64(s[1][h],
+                                                  _mm_slli_epi64(s[1][h], 2));
+                        x = rotl_sse2(x, 7);
+                        x = _mm_add_epi64(x, _mm_slli_epi64(x, 3));
+                        _mm_storeu_si128((__m128i *)&rng->buf[i + 2*h], x);
+                        __m128i t = _mm_slli_epi64(s[1][h], 17);
+                        s[2][h] = _mm_xor_si128(s[2][h], s[0][h]);
+                        s[3][h] = _mm_xor_si128(s[3][h], s[1][h]);
+                        s[1][h] = _mm_xor_si128(s[1][h], s[2][h]);
+                        s[0][h] = _mm_xor_si128(s[0][h], s[3][h]);
+                        s[2][h] = _mm_xor_si128(s[2][h], t);
+                        s[3][h] = rotl_sse2(s[3][h], 45);
+                }
+        }
+        for (int i=0; i<4; i++) {
+                for (int h=0; h<2; h++) {
+                        _mm_storeu_si128((__m128i *)&rng->s[i][2*h], s[i][h]);
+                }
+        }
+}
+#endif
+__attribute__((target("avx2")))
+static inline __m256i rotl_avx2(__m256i x, int k) {
+        return _mm256_or_si256(_mm256_slli_epi64(x, k),
+                               _mm256_srli_epi64(x, 64 - k));
+}
+__attribute__((target("avx2")))
+static void refill_avx2(rng_t *rng) {
+        _Static_assert(RNG_LANES == 4, "four lanes per AVX2 register");
+        __m256i s[4];
+        for (int i=0; i<4; i++) {
+                s[i] = _mm256_loadu_si256((__m256i *)rng->s[i]);
+        }
+        for (size_t i=0; i<RNG_BATCH; i+=RNG_LANES) {
+                __m256i x = _mm256_add_epi64(s[1], _mm256_slli_epi64(s[1], 2));
+                x = rotl_avx2(x, 7);
+                x = _mm256_add_epi64(x, _mm256_slli_epi64(x, 3));
+                _mm256_storeu_si256((__m256i *)&rng->buf[i], x);
+                __m256i t = _mm256_slli_epi64(s[1], 17);
+                s[2] = _mm256_xor_si256(s[2], s[0]);
+                s[3] = _mm256_xor_si256(s[3], s[1]);
+                s[1] = _mm256_xor_si256(s[1], s[2]);
+                s[0] = _mm256_xor_si256(s[0], s[3]);
+                s[2] = _mm256_xor_si256(s[2], t);
+                s[3] = rotl_avx2(s[3], 45);
+        }
+        for (int i=0; i<4; i++) {
+                _mm256_storeu_si256((__m256i *)rng->s[i], s[i]);
+        }
+}
+#endif
+void rng_refill(rng_t *rng) {
+        rng->pos = 0;
+#ifdef HAVE_X86
+        if (rng->have_avx2) {
+                refill_avx2(rng);
+                return;
+        }
+#ifdef __SSE2__
+        refill_sse2(rng);
+        return;
+#endif
+#endif
+        refill_scalar(rng);
+}
@@ -0,0 +1,57 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* generators stepped side by side, one per vector lane */
+#define RNG_LANES       4
+/* words made per refill, a multiple of RNG_LANES */
+#define RNG_BATCH       256
+
+/* xoshiro256** (Blackman and Vigna): a small, fast generator whose state
+ * is owned by its user, so every thread can draw from its own without
+ * locks, and a run is reproduced from its seed. RNG_LANES independent
+ * generators are stepped together by SIMD kernels, which fill buf a batch
+ * at a time; draws then just read the next word of it. */
+typedef struct rng rng_t;
+struct rng {
+        /* s[i][l] is word i of the state of lane l */
+        uint64_t s[4][RNG_LANES];
+        uint64_t buf[RNG_BATCH];
+        /* next unread word of buf */
+        size_t pos;
+        bool have_avx2;
+};
+
+/** Seeds rng; the states are expanded from seed with splitmix64, so any
+ * seed, 0 included, gives good ones */
+void rng_seed(rng_t *rng, uint64_t seed);
+/** Refills the batch of rng */
+void rng_refill(rng_t *rng);
+
+static inline uint64_t rng_next(rng_t *rng) {
+        if (rng->pos == RNG_BATCH) {
+                rng_refill(rng);
+        }
+        return rng->buf[rng->pos++];
+}
+/** Returns a uniform integer in [0, n), n > 0, without the bias of a
+ * modulo (Lemire's multiply and reject) */
+static inline uint64_t rng_below(rng_t *rng, uint64_t n) {
+        unsigned __int128 m = (unsigned __int128)rng_next(rng) * n;
+        if ((uint64_t)m < n) {
+                uint64_t threshold = -n % n;
+                while ((uint64_t)m < threshold) {
+                        m = (unsigned __int128)rng_next(rng) * n;
+                }
+        }
+        return m >> 64;
+}
+/** Returns a uniform double in [0, 1) */
+static inline double rng_uniform(rng_t *rng) {
+        return (rng_next(rng) >> 11) * 0x1.0p-53;
+}
+
+#endif /* !RNG_H */
@@ -0,0 +1,75 @@
+#include "sizes.h"
+#include <math.h>
+#include <float.h>
+#include <stdbool.h>
+
+/* up to this many decimals are scaled away */
+#define MAX_DECIMALS    6
+/* relative slack for the decimal -> binary rounding of the input */
+#define SCALE_EPS       (64 * LDBL_EPSILON)
+/* so that fill + size cannot overflow 64 bits */
+#define U64_CAP_MAX     (UINT64_C(1) << 62)
+
+/** Returns true if value * scale is a whole number up to input rounding */
+static bool is_scalable(long double value, long double scale) {
+        long double scaled = value * scale;
+        if ((scaled < 0) || (scaled > (long double)U64_CAP_MAX)) {
+                return false;
+        }
+        return fabsl(scaled - roundl(scaled)) <= scaled * SCALE_EPS;
+}
+/** Returns the smallest power of ten that makes all sizes integral, or 0 */
+static long double find_scale(const long double *item_sizes,
+                              size_t num_items, long double bin_cap) {
+        long double scale = 1;
+        for (int d=0; d<=MAX_DECIMALS; d++, scale *= 10) {
+                bool ok = is_scalable(bin_cap, scale);
+                for (size_t i=0; ok && (i<num_items); i++) {
+                        ok = is_scalable(item_sizes[i], scale);
+                }
+                if (ok) {
+                        return scale;
+                }
+        }
+        return 0;
+}
+
+sizes_t *sizes_new(arena_t *arena, const long double *item_sizes,
+                   size_t num_items, long double bin_cap) {
+        sizes_t *sizes = arena_alloc(arena, sizeof(*sizes));
+        *sizes = (sizes_t){.kind = SIZE_FLOAT,
+                           .num_items = num_items,
+                           .scale = find_scale(item_sizes, num_items,
+                                               bin_cap),
+                           .bin_cap = bin_cap,
+                           .orig = item_sizes};
+        if (sizes->scale == 0) {
+                sizes->cap.f = bin_cap;
+                sizes->f = item_sizes;
+                return sizes;
+        }
+        sizes->cap.i = llroundl(bin_cap * sizes->scale);
+        if (sizes->cap.i <= UINT32_MAX) {
+                uint32_t *u32 = arena_alloc(arena, num_items * sizeof(*u32));
+                for (size_t i=0; i<num_items; i++) {
+                        u32[i] = llroundl(item_sizes[i] * sizes->scale);
+                }
+                sizes->kind = SIZE_U32;
+                sizes->u32 = u32;
+        } else {
+                uint64_t *u64 = arena_alloc(arena, num_items * sizeof(*u64));
+                for (size_t i=0; i<num_items; i++) {
+                        u64[i] = llroundl(item_sizes[i] * sizes->scale);
+                }
+                sizes->kind = SIZE_U64;
+                sizes->u64 = u64;
+        }
+        return sizes;
+}
+
+long double sizes_fill(const sizes_t *sizes, const fill_t *fill) {
+        if (sizes->kind == SIZE_FLOAT) {
+                return fill->f;
+        }
+        return fill->i / sizes->scale;
+}
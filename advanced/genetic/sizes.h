@@ -0,0 +1,73 @@
+#ifndef SIZES_H
+#define SIZES_H
+
+#include "arena.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/* How a problem's item sizes are represented inside the GA. Sizes that
+ * are integral, or have a fixed number of decimals, are scaled to
+ * integers when the problem is loaded, so bin fills are compared exactly
+ * and without x87 arithmetic; anything else stays long double. */
+enum size_kind {
+        SIZE_U32,       /* scaled capacity fits 32 bits */
+        SIZE_U64,
+        SIZE_FLOAT,
+};
+
+/* a bin's fill, in the representation of its problem's size_kind */
+typedef union fill fill_t;
+union fill {
+        uint64_t i;             /* SIZE_U32 and SIZE_U64 */
+        long double f;          /* SIZE_FLOAT */
+};
+
+typedef struct sizes sizes_t;
+struct sizes {
+        enum size_kind kind;
+        size_t num_items;
+        /* the integer sizes are the given ones multiplied by scale */
+        long double scale;
+        long double bin_cap;
+        fill_t cap;
+        /* as given */
+        const long double *orig;
+        union {
+                const uint32_t *u32;
+                const uint64_t *u64;
+                const long double *f;
+        };
+};
+
+/* The table lives in arena; item_sizes must outlive it. */
+sizes_t *sizes_new(arena_t *arena, const long double *item_sizes,
+                   size_t num_items, long double bin_cap);
+
+/* The union is passed by address, not by value: its long double makes
+ * GCC note an ABI change wherever it is passed by value. */
+
+/** Sets *size to the size of item, as a fill */
+static inline void sizes_item(const sizes_t *sizes, size_t item,
+                              fill_t *size) {
+        switch (sizes->kind) {
+        case SIZE_U32:
+                size->i = sizes->u32[item];
+                break;
+        case SIZE_U64:
+                size->i = sizes->u64[item];
+                break;
+        default:
+                size->f = sizes->f[item];
+                break;
+        }
+}
+/** Returns the size of item, for sizes of an integer kind */
+static inline uint64_t sizes_int(const sizes_t *sizes, size_t item) {
+        return (sizes->kind == SIZE_U32) ? sizes->u32[item]
+                                         : sizes->u64[item];
+}
+
+/** Returns a fill in the units of the given sizes */
+long double sizes_fill(const sizes_t *sizes, const fill_t *fill);
+
+#endif /* !SIZES_H */